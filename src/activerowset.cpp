@@ -11,20 +11,50 @@
 
 #include "activerowset.h"
 
+#include <algorithm>
+
 #include "partition.h"
+#include "randomsource.h"
+
+ActiveRowSet::ActiveRowSet() {
+    num_elements_ = 0;
+}
+
+ActiveRowSet::ActiveRowSet(t_vertex_id size) {
+    Reset(size);
+}
+
+ActiveRowSet::ActiveRowSet(Partition* clusters) {
+    // rows are identified by the first vertex of a cluster
+    t_vertex_id max_row = -1;
+    for (size_t i = 0; i < clusters->get_partition_vector()->size(); i++)
+        max_row = std::max(max_row, *(clusters->get_partition_vector()->at(i)->begin()));
 
-ActiveRowSet::ActiveRowSet(int size) {
+    Reset(clusters, max_row + 1);
+}
+
+/*
+ * all rows 0..size-1 are active, the buffers of earlier uses are reused
+ */
+void ActiveRowSet::Reset(t_vertex_id size) {
     num_elements_ = size;
     elements_.resize(size);
+    if ((t_vertex_id) element_lookup_.size() < size)
+        element_lookup_.resize(size);
 
-    for (int i = 0; i < size; i++) {
+    for (t_vertex_id i = 0; i < size; i++) {
         elements_[i] = i;
         element_lookup_[i] = i;
     }
 }
 
-ActiveRowSet::ActiveRowSet(Partition* clusters) {
+/*
+ * the rows of the first vertices of all clusters are active
+ */
+void ActiveRowSet::Reset(Partition* clusters, t_vertex_id vertex_count) {
     elements_.resize(clusters->get_partition_vector()->size());
+    if ((t_vertex_id) element_lookup_.size() < vertex_count)
+        element_lookup_.resize(vertex_count);
 
     for (size_t i = 0; i < clusters->get_partition_vector()->size(); i++) {
         elements_[i] = *(clusters->get_partition_vector()->at(i)->begin());
@@ -37,23 +67,40 @@ ActiveRowSet::ActiveRowSet(Partition* clusters) {
 ActiveRowSet::~ActiveRowSet() {
 }
 
-int ActiveRowSet::GetRandomElement() {
-    int randnumber = rand() % num_elements_;
+t_vertex_id ActiveRowSet::GetRandomElement(RandomSource* random) {
+#ifdef RGMC_64BIT_VERTEX_IDS
+    // Next() yields only 31 random bits, combine two draws
+    t_vertex_id randnumber = (((t_vertex_id) random->Next() << 31) |
+            random->Next()) % num_elements_;
+#else
+    t_vertex_id randnumber = random->Next() % num_elements_;
+#endif
     return elements_[randnumber];
 }
 
-int ActiveRowSet::Get(int &index) {
+t_vertex_id ActiveRowSet::Get(t_vertex_id &index) {
     return elements_[index];
 }
 
-int ActiveRowSet::GetActiveRowCount() {
+t_vertex_id ActiveRowSet::GetActiveRowCount() {
     return num_elements_;
 }
 
-void ActiveRowSet::Remove(int &element) {
+void ActiveRowSet::Remove(t_vertex_id &element) {
     // copy id from row in last active bucket to bucket of deleted row
-    int bucket_id = element_lookup_[element];
+    t_vertex_id bucket_id = element_lookup_[element];
     element_lookup_[elements_[num_elements_ - 1]] = bucket_id;
     elements_[bucket_id] = elements_[num_elements_ - 1];
     num_elements_--;
 }
+
+size_t ActiveRowSet::GetMemoryBytes() {
+    return (elements_.capacity() + element_lookup_.capacity()) *
+            sizeof(t_vertex_id);
+}
+
+void ActiveRowSet::Release() {
+    std::vector<t_vertex_id>().swap(elements_);
+    std::vector<t_vertex_id>().swap(element_lookup_);
+    num_elements_ = 0;
+}
@@ -12,27 +12,35 @@
 #ifndef ACTIVEROWSET_H_
 #define ACTIVEROWSET_H_
 
+#include <stddef.h>
 #include <vector>
 
-#include <boost/unordered_map.hpp>
+#include "indextypes.h"
 
 class Partition;
+class RandomSource;
 
 class ActiveRowSet {
 public:
-    ActiveRowSet(int size);
+    ActiveRowSet();
+    ActiveRowSet(t_vertex_id size);
     ActiveRowSet(Partition* clusters);
     virtual ~ActiveRowSet();
 
-    void Remove(int &element);
-    int GetRandomElement();
-    int Get(int &index);
-    int GetActiveRowCount();
+    void Reset(t_vertex_id size);
+    void Reset(Partition* clusters, t_vertex_id vertex_count);
+
+    void Remove(t_vertex_id &element);
+    t_vertex_id GetRandomElement(RandomSource* random);
+    t_vertex_id Get(t_vertex_id &index);
+    t_vertex_id GetActiveRowCount();
+    size_t GetMemoryBytes();
+    void Release();
 
 private:
-    std::vector<int> elements_;
-    boost::unordered_map<int, int> element_lookup_;
-    int num_elements_;
+    std::vector<t_vertex_id> elements_;
+    std::vector<t_vertex_id> element_lookup_; // maps row -> index in elements_
+    t_vertex_id num_elements_;
 };
 
 #endif /* ACTIVEROWSET_H_ */
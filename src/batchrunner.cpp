@@ -0,0 +1,262 @@
+//============================================================================
+// Name        : BatchRunner.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : clusters all graphs listed in a manifest file with a pool of
+//               worker threads, the next graphs are loaded while the current
+//               ones are clustered
+//============================================================================
+
+
+#include "batchrunner.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include <boost/foreach.hpp>
+#include <boost/tokenizer.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "clusteringio.h"
+#include "modoptimizer.h"
+#include "graph.h"
+#include "partition.h"
+#include "walltime.h"
+#include "vertexorder.h"
+
+namespace po = boost::program_options;
+
+BatchRunner::BatchRunner(int threads, bool numa) {
+    threads_ = threads < 1 ? 1 : threads;
+    numa_ = numa;
+    max_loaded_jobs_ = threads_ + 1;
+    loading_done_ = false;
+    failed_jobs_ = 0;
+}
+
+BatchRunner::~BatchRunner() {
+    for (size_t i = 0; i < jobs_.size(); i++)
+        delete jobs_[i];
+}
+
+/*
+ * Runs all jobs of the manifest and returns the number of failed jobs. With
+ * NUMA placement on a machine with several nodes the graphs, which are
+ * shared by the workers, are interleaved over the nodes and every worker is
+ * pinned to a node, so the structures of its runs are local.
+ */
+int BatchRunner::Run(std::string manifest_filename) {
+    if (!ReadManifest(manifest_filename))
+        return -1;
+
+    if (numa_ && !placement_.Detect()) {
+        std::cerr << "NUMA placement not used: " << placement_.get_error()
+                << std::endl;
+        numa_ = false;
+    }
+
+    boost::thread loader(&BatchRunner::LoadGraphs, this);
+    boost::thread_group workers;
+    for (int i = 0; i < threads_; i++)
+        workers.create_thread(boost::bind(&BatchRunner::ProcessJobs, this, i));
+
+    loader.join();
+    workers.join_all();
+
+    return failed_jobs_;
+}
+
+/*
+ * reads one job per line, a line holds the same options as the command line,
+ * e.g. "--file=a.graph --algorithm=3 --outfile=a.out --seed=1"
+ * empty lines and lines starting with # are skipped
+ */
+bool BatchRunner::ReadManifest(std::string manifest_filename) {
+    std::ifstream infile(manifest_filename.data());
+    if (!infile) {
+        std::cerr << "Could not open manifest file." << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (getline(infile, line)) {
+        line_number++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos ||
+                line[line.find_first_not_of(" \t\r")] == '#')
+            continue;
+
+        boost::char_separator<char> sep(" \t\r");
+        boost::tokenizer<boost::char_separator<char> > tokens(line, sep);
+        std::vector<std::string> args(tokens.begin(), tokens.end());
+
+        ClusteringJob* job = new ClusteringJob();
+        po::options_description desc;
+        AddClusteringOptions(&desc, job);
+
+        try {
+            po::variables_map vm;
+            po::store(po::command_line_parser(args).options(desc).run(), vm);
+            po::notify(vm);
+            ReadClusteringOptions(&vm, job);
+        } catch (po::error& e) {
+            std::cerr << "Manifest line " << line_number << ": " << e.what()
+                    << std::endl;
+            delete job;
+            return false;
+        }
+
+        if (job->filename.empty() || !IsSupportedGraphFile(job->filename) ||
+                !IsValidAlgorithm(job->algorithm) ||
+                !IsValidEnsembleBase(job->ensemble_base) ||
+                !IsValidVertexOrder(job->vertex_order) ||
+                !IsValidOutputFormat(job->out_format)) {
+            std::cerr << "Manifest line " << line_number
+                    << ": missing or unsupported graph file or invalid parameter."
+                    << std::endl;
+            delete job;
+            return false;
+        }
+
+        // every job needs its own output file
+        if (job->out_filename.empty()) {
+            std::ostringstream name;
+            name << job->filename << "." << jobs_.size() + 1 << ".out";
+            job->out_filename = name.str();
+        }
+
+        jobs_.push_back(job);
+    }
+    return true;
+}
+
+/*
+ * loads the graphs of all jobs in manifest order, consecutive jobs on the
+ * same file (and vertex order) share one copy of the graph
+ */
+void BatchRunner::LoadGraphs() {
+    boost::shared_ptr<Graph> last_graph;
+    std::string last_key;
+
+    if (numa_ && !placement_.InterleaveThreadMemory(true))
+        std::cerr << "Graphs not interleaved: " << strerror(errno) << std::endl;
+
+    for (size_t i = 0; i < jobs_.size(); i++) {
+        {
+            boost::unique_lock<boost::mutex> lock(queue_mutex_);
+            while (loaded_jobs_.size() >= max_loaded_jobs_)
+                queue_changed_.wait(lock);
+        }
+
+        LoadedJob* loaded_job = new LoadedJob();
+        loaded_job->index = i + 1;
+        loaded_job->job = jobs_[i];
+        loaded_job->load_time = 0;
+
+        if (GetGraphKey(jobs_[i]) == last_key) {
+            loaded_job->graph = last_graph;
+        } else {
+            last_graph.reset();
+            double start = GetWallTime();
+            loaded_job->graph.reset(LoadJobGraph(jobs_[i]));
+            loaded_job->load_time = GetWallTime() - start;
+            last_graph = loaded_job->graph;
+            last_key = GetGraphKey(jobs_[i]);
+        }
+
+        boost::unique_lock<boost::mutex> lock(queue_mutex_);
+        loaded_jobs_.push_back(loaded_job);
+        queue_changed_.notify_all();
+    }
+
+    boost::unique_lock<boost::mutex> lock(queue_mutex_);
+    loading_done_ = true;
+    queue_changed_.notify_all();
+}
+
+void BatchRunner::ProcessJobs(int worker) {
+    if (numa_ && !placement_.PinThread(worker)) {
+        boost::unique_lock<boost::mutex> lock(output_mutex_);
+        std::cerr << "Worker " << worker << " not pinned: " << strerror(errno)
+                << std::endl;
+    }
+
+    while (true) {
+        LoadedJob* loaded_job;
+        {
+            boost::unique_lock<boost::mutex> lock(queue_mutex_);
+            while (loaded_jobs_.empty() && !loading_done_)
+                queue_changed_.wait(lock);
+            if (loaded_jobs_.empty())
+                return;
+
+            loaded_job = loaded_jobs_.front();
+            loaded_jobs_.pop_front();
+            queue_changed_.notify_all();
+        }
+
+        ProcessJob(loaded_job);
+        delete loaded_job;
+    }
+}
+
+/*
+ * clusters the graph of a job, stores the result and prints one summary line
+ */
+void BatchRunner::ProcessJob(LoadedJob* loaded_job) {
+    ClusteringJob* job = loaded_job->job;
+    Graph* graph = loaded_job->graph.get();
+
+    if (graph->get_vertex_count() < 2) {
+        boost::unique_lock<boost::mutex> lock(output_mutex_);
+        std::cout << "job: " << loaded_job->index << "  file: " << job->filename
+                << "  failed: graph could not be loaded" << std::endl;
+        failed_jobs_++;
+        return;
+    }
+
+    if (!job->has_seed) {
+        job->seed = (int) time(NULL) + loaded_job->index;
+        job->has_seed = true;
+    }
+
+    ModOptimizer gclusterer(graph);
+    double start = GetWallTime();
+    bool success = RunClustering(&gclusterer, graph, job);
+    double time = GetWallTime() - start;
+
+    if (!success) {
+        boost::unique_lock<boost::mutex> lock(output_mutex_);
+        std::cout << "job: " << loaded_job->index << "  file: " << job->filename
+                << "  failed: initial partition could not be used or memory limit too low" << std::endl;
+        failed_jobs_++;
+        return;
+    }
+
+    Partition* final_clusters = gclusterer.GetClusters();
+    double Q = gclusterer.GetModularityFromClustering(graph, final_clusters);
+    bool stored = StoreClustering(job->out_filename, final_clusters, graph,
+            job->out_format);
+    stored = StoreJobDendrogram(&gclusterer, job) && stored;
+
+    boost::unique_lock<boost::mutex> lock(output_mutex_);
+    if (!stored) {
+        std::cout << "job: " << loaded_job->index << "  file: " << job->filename
+                << "  failed: output could not be written" << std::endl;
+        failed_jobs_++;
+        return;
+    }
+    std::cout << "job: " << loaded_job->index << "  file: " << job->filename
+            << "  Q: " << Q
+            << "  clusters: " << final_clusters->get_partition_vector()->size()
+            << "  load [sec]: " << loaded_job->load_time
+            << "  time [sec]: " << time
+            << GetTruncationReport(&gclusterer) << std::endl;
+    std::cout << GetCounterReport(&gclusterer, graph);
+    std::cout << GetMemoryReport(&gclusterer, job);
+}
@@ -0,0 +1,62 @@
+//============================================================================
+// Name        : BatchRunner.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : clusters all graphs listed in a manifest file with a pool of
+//               worker threads, the next graphs are loaded while the current
+//               ones are clustered
+//============================================================================
+
+
+#ifndef BATCHRUNNER_H_
+#define BATCHRUNNER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "clusteringjob.h"
+#include "numaplacement.h"
+
+class Graph;
+
+class BatchRunner {
+public:
+    BatchRunner(int threads, bool numa = false);
+    virtual ~BatchRunner();
+
+    int Run(std::string manifest_filename);
+
+private:
+    struct LoadedJob {
+        int index;
+        ClusteringJob* job;
+        boost::shared_ptr<Graph> graph;
+        double load_time;
+    };
+
+    int threads_;
+    bool numa_;              // workers pinned to the nodes round robin
+    NumaPlacement placement_;
+    size_t max_loaded_jobs_; // bounds the number of graphs held in memory
+    std::vector<ClusteringJob*> jobs_;
+    std::deque<LoadedJob*> loaded_jobs_;
+    bool loading_done_;
+    int failed_jobs_;
+
+    boost::mutex queue_mutex_;
+    boost::mutex output_mutex_;
+    boost::condition_variable queue_changed_;
+
+    bool ReadManifest(std::string manifest_filename);
+    void LoadGraphs();
+    void ProcessJobs(int worker);
+    void ProcessJob(LoadedJob* loaded_job);
+};
+
+#endif /* BATCHRUNNER_H_ */
@@ -0,0 +1,212 @@
+#!/bin/bash
+#============================================================================
+# Name        : benchmark.sh
+# Author      :
+# Version     :
+# Copyright   : Karlsruhe Institute of Technology
+# Description : scaling benchmark of RG, CGGC_RG and CGGCi_RG over graph
+#               size, threads and sample/ensemble sizes, writes a CSV file
+#               and compares it with a baseline
+#============================================================================
+#
+# usage: benchmark.sh [-o out.csv] [-b baseline.csv] [-t percent] rgmc
+#
+#   -o  result file (default: bench/results.csv)
+#   -b  baseline written by an earlier run, every configuration whose wall
+#       time or peak RSS grew by more than the threshold or whose Q dropped
+#       by more than QTOLERANCE is reported, the exit status is then 1
+#   -t  threshold in percent (default: 10)
+#
+# The sweep is set by environment variables (defaults in brackets):
+#   SIZES          vertices of the generated graphs [10000 100000]
+#   THREADS        values of --threads [1 2 4]
+#   KS             --k of RG [1 2 4]
+#   FINALKS        --finalk of CGGC_RG and CGGCi_RG [500 2000]
+#   ENSEMBLESIZES  --ensemblesize of CGGC_RG and CGGCi_RG [-1 8]
+#   REPEAT         runs per configuration, the fastest counts [3]
+#   SEED           seed of the graphs and the runs [1]
+#   QTOLERANCE     allowed drop of Q against the baseline [0.001]
+#   MINTIME        wall times below this many seconds are not compared [0.05]
+#   BENCH_DIR      directory of the generated graphs [bench]
+#
+# The generated graphs have communities of 10 to 100 consecutive vertices,
+# every vertex draws four neighbors in its community and one anywhere. They
+# are kept in BENCH_DIR and only generated again if missing. email.graph is
+# always included.
+
+OUT=""
+BASELINE=""
+THRESHOLD=10
+while getopts "o:b:t:" option; do
+    case $option in
+        o) OUT=$OPTARG ;;
+        b) BASELINE=$OPTARG ;;
+        t) THRESHOLD=$OPTARG ;;
+        *) exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+RGMC=$1
+if [ -z "$RGMC" ] || [ ! -x "$RGMC" ]; then
+    echo "usage: $0 [-o out.csv] [-b baseline.csv] [-t percent] rgmc" >&2
+    exit 2
+fi
+
+SIZES=${SIZES:-"10000 100000"}
+THREADS=${THREADS:-"1 2 4"}
+KS=${KS:-"1 2 4"}
+FINALKS=${FINALKS:-"500 2000"}
+ENSEMBLESIZES=${ENSEMBLESIZES:-"-1 8"}
+REPEAT=${REPEAT:-3}
+SEED=${SEED:-1}
+QTOLERANCE=${QTOLERANCE:-0.001}
+MINTIME=${MINTIME:-0.05}
+BENCH_DIR=${BENCH_DIR:-bench}
+OUT=${OUT:-$BENCH_DIR/results.csv}
+SRC_DIR=$(dirname "$0")
+
+mkdir -p "$BENCH_DIR"
+
+# writes a METIS file with n vertices
+generate_graph() {
+    awk -v n="$1" -v seed="$SEED" '
+        function add(a, b,   key) {
+            if (a == b) return
+            key = a < b ? a " " b : b " " a
+            if (key in seen) return
+            seen[key] = 1
+            adj[a] = adj[a] " " (b + 1)
+            adj[b] = adj[b] " " (a + 1)
+            m++
+        }
+        BEGIN {
+            srand(seed)
+            for (v = 0; v < n; v += size) {
+                size = 10 + int(rand() * 91)
+                if (v + size > n) size = n - v
+                for (i = v; i < v + size; i++) {
+                    first[i] = v
+                    count[i] = size
+                }
+            }
+            for (i = 0; i < n; i++) {
+                for (j = 0; j < 4 && count[i] > 1; j++)
+                    add(i, first[i] + int(rand() * count[i]))
+                add(i, int(rand() * n))
+            }
+            print n, m
+            for (i = 0; i < n; i++)
+                print adj[i]
+        }' > "$2.tmp" && mv "$2.tmp" "$2"
+}
+
+now() {
+    date +%s.%N
+}
+
+GRAPHS="$SRC_DIR/email.graph"
+for n in $SIZES; do
+    graph=$BENCH_DIR/planted_$n.graph
+    if [ ! -f "$graph" ]; then
+        echo "generating $graph" >&2
+        generate_graph "$n" "$graph"
+    fi
+    GRAPHS="$GRAPHS $graph"
+done
+
+# runs one configuration REPEAT times and appends its line to OUT
+run_config() {
+    local graph=$1 algorithm=$2 threads=$3 k=$4 finalk=$5 ensemblesize=$6
+    local best_wall="" output="" run start end wall
+
+    for ((run = 0; run < REPEAT; run++)); do
+        start=$(now)
+        output=$("$RGMC" --file="$graph" --algorithm="$algorithm" \
+                --threads="$threads" --k="$k" --finalk="$finalk" \
+                --ensemblesize="$ensemblesize" --seed="$SEED" \
+                --perf-counters 2>/dev/null)
+        if [ $? -ne 0 ]; then
+            echo "failed: $graph algorithm $algorithm threads $threads" >&2
+            return
+        fi
+        end=$(now)
+        wall=$(awk -v s="$start" -v e="$end" 'BEGIN { printf "%.4f", e - s }')
+        if [ -z "$best_wall" ] || awk -v a="$wall" -v b="$best_wall" \
+                'BEGIN { exit !(a < b) }'; then
+            best_wall=$wall
+        fi
+    done
+
+    # Q, peak RSS and CPU time of the process and the phase times of the
+    # last run
+    echo "$output" | awk -v graph="$(basename "$graph")" \
+            -v algorithm="$algorithm" -v threads="$threads" -v k="$k" \
+            -v finalk="$finalk" -v ensemblesize="$ensemblesize" \
+            -v seed="$SEED" -v wall="$best_wall" \
+            -v vertices="$(head -1 "$graph" | awk '{ print $1 }')" '
+        /^Q: / { q = $2 }
+        /^phase: / {
+            phases = phases (phases == "" ? "" : ";") $2 "=" $5
+        }
+        /^peak RSS/ { rss = $4; cpu = $7 }
+        END {
+            printf "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,\"%s\"\n", graph,
+                    vertices, algorithm, threads, k, finalk, ensemblesize,
+                    seed, wall, cpu, rss, q, phases
+        }' >> "$OUT"
+}
+
+echo "graph,vertices,algorithm,threads,k,finalk,ensemblesize,seed,wall_sec,cpu_sec,peak_rss_mb,q,phases" > "$OUT"
+for graph in $GRAPHS; do
+    for threads in $THREADS; do
+        echo "$(basename "$graph"), $threads threads" >&2
+        for k in $KS; do
+            run_config "$graph" 1 "$threads" "$k" 2000 -1
+        done
+        for algorithm in 2 3; do
+            for finalk in $FINALKS; do
+                for ensemblesize in $ENSEMBLESIZES; do
+                    run_config "$graph" "$algorithm" "$threads" 2 "$finalk" \
+                            "$ensemblesize"
+                done
+            done
+        done
+    done
+done
+echo "results written to $OUT" >&2
+
+if [ -z "$BASELINE" ]; then
+    exit 0
+fi
+
+# configurations are matched by graph, algorithm, threads, k, finalk,
+# ensemblesize and seed
+awk -F, -v threshold="$THRESHOLD" -v qtolerance="$QTOLERANCE" \
+        -v mintime="$MINTIME" '
+    FNR == 1 { next }
+    { key = $1 "," $3 "," $4 "," $5 "," $6 "," $7 "," $8 }
+    NR == FNR { base_wall[key] = $9; base_rss[key] = $11; base_q[key] = $12; next }
+    !(key in base_q) { next }
+    {
+        compared++
+        limit = 1 + threshold / 100
+        if ($9 >= mintime && $9 > base_wall[key] * limit) {
+            printf "REGRESSION %s: wall time %.3f s, baseline %.3f s\n",
+                    key, $9, base_wall[key]
+            regressions++
+        }
+        if (base_rss[key] > 0 && $11 > base_rss[key] * limit) {
+            printf "REGRESSION %s: peak RSS %.1f MB, baseline %.1f MB\n",
+                    key, $11, base_rss[key]
+            regressions++
+        }
+        if ($12 < base_q[key] - qtolerance) {
+            printf "REGRESSION %s: Q %s, baseline %s\n", key, $12, base_q[key]
+            regressions++
+        }
+    }
+    END {
+        printf "%d configurations compared with the baseline, %d regressions\n",
+                compared, regressions
+        exit (regressions > 0)
+    }' "$BASELINE" "$OUT"
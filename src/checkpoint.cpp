@@ -0,0 +1,169 @@
+//============================================================================
+// Name        : Checkpoint.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : state of a CGGC/CGGCi run between two phases, written to a
+//               binary file so that a preempted run can be resumed
+//============================================================================
+
+
+#include "checkpoint.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+#include "graph.h"
+#include "partition.h"
+
+/*
+ * File layout (host byte order):
+ *   char[8]           "RGMCCKPT"
+ *   uint32            format version (2)
+ *   uint32            sizeof(t_vertex_id)
+ *   t_vertex_id       number of vertices n
+ *   t_edge_count      number of edges
+ *   uint64            Graph::GetContentHash of the graph
+ *   CGGCCheckpoint    stage, progress, Q, random state and ensemble key
+ *   t_vertex_id       number of clusters c
+ *   t_vertex_id       c cluster sizes
+ *   t_vertex_id       n vertices (ids in file order) cluster by cluster
+ * The clusters and their vertices are stored in the order of the partition.
+ * As the rows of the cluster matrix do not keep buckets of earlier runs, the
+ * RG steps after a resume then join in the same order as without
+ * interruption and give the same clustering.
+ */
+static const char kMagic[8] = {'R', 'G', 'M', 'C', 'C', 'K', 'P', 'T'};
+static const uint32_t kVersion = 2;
+
+/*
+ * writes the checkpoint to a temporary file that replaces the file only when
+ * it is complete, so an interrupted write keeps the previous checkpoint
+ */
+bool StoreCheckpoint(std::string filename, Graph* graph,
+        CGGCCheckpoint* checkpoint, Partition* clusters) {
+    t_partition* cluster_vector = clusters->get_partition_vector();
+    std::vector<t_vertex_id> sizes;
+    std::vector<t_vertex_id> vertices;
+    vertices.reserve(graph->get_vertex_count());
+    for (size_t i = 0; i < cluster_vector->size(); i++) {
+        if (cluster_vector->at(i) == NULL) continue;
+        sizes.push_back(cluster_vector->at(i)->size());
+        BOOST_FOREACH(t_vertex_id vertex_id, *cluster_vector->at(i))
+            vertices.push_back(graph->GetOriginalId(vertex_id));
+    }
+    t_vertex_id cluster_count = sizes.size();
+
+    std::string temp_filename = filename + ".tmp";
+    std::ofstream out(temp_filename.data(),
+            std::ios_base::out | std::ios_base::binary);
+    if (!out) {
+        std::cerr << "Cannot open checkpoint file.\n";
+        return false;
+    }
+
+    uint32_t version = kVersion;
+    uint32_t id_size = sizeof(t_vertex_id);
+    t_vertex_id vertex_count = graph->get_vertex_count();
+    t_edge_count edge_count = graph->get_edge_count();
+    uint64_t content_hash = graph->GetContentHash();
+    out.write(kMagic, sizeof(kMagic));
+    out.write((const char*) &version, sizeof(version));
+    out.write((const char*) &id_size, sizeof(id_size));
+    out.write((const char*) &vertex_count, sizeof(vertex_count));
+    out.write((const char*) &edge_count, sizeof(edge_count));
+    out.write((const char*) &content_hash, sizeof(content_hash));
+    out.write((const char*) checkpoint, sizeof(CGGCCheckpoint));
+    out.write((const char*) &cluster_count, sizeof(cluster_count));
+    out.write((const char*) &sizes[0], cluster_count * sizeof(t_vertex_id));
+    out.write((const char*) &vertices[0],
+            vertices.size() * sizeof(t_vertex_id));
+    out.close();
+
+    if (!out || rename(temp_filename.data(), filename.data()) != 0) {
+        std::cerr << "Cannot write checkpoint file.\n";
+        remove(temp_filename.data());
+        return false;
+    }
+    return true;
+}
+
+/*
+ * reads a checkpoint written for the same graph (same content hash, so also
+ * the same vertex order), returns the clusters stored with it or NULL if
+ * there is no such checkpoint
+ */
+Partition* LoadCheckpoint(std::string filename, Graph* graph,
+        CGGCCheckpoint* checkpoint) {
+    std::ifstream in(filename.data(), std::ios_base::in | std::ios_base::binary);
+    if (!in)
+        return NULL;
+
+    char magic[8];
+    uint32_t version, id_size;
+    t_vertex_id vertex_count;
+    t_edge_count edge_count;
+    uint64_t content_hash;
+    in.read(magic, sizeof(magic));
+    in.read((char*) &version, sizeof(version));
+    in.read((char*) &id_size, sizeof(id_size));
+    in.read((char*) &vertex_count, sizeof(vertex_count));
+    in.read((char*) &edge_count, sizeof(edge_count));
+    in.read((char*) &content_hash, sizeof(content_hash));
+    in.read((char*) checkpoint, sizeof(CGGCCheckpoint));
+    if (!in || memcmp(magic, kMagic, sizeof(magic)) != 0 ||
+            version != kVersion || id_size != sizeof(t_vertex_id) ||
+            vertex_count != graph->get_vertex_count() ||
+            edge_count != graph->get_edge_count() ||
+            content_hash != graph->GetContentHash()) {
+        std::cerr << "Checkpoint file does not belong to this graph.\n";
+        return NULL;
+    }
+    checkpoint->ensemble_key[kEnsembleKeySize - 1] = '\0';
+
+    t_vertex_id cluster_count;
+    in.read((char*) &cluster_count, sizeof(cluster_count));
+    if (!in || cluster_count < 1 || cluster_count > vertex_count) {
+        std::cerr << "Checkpoint file is corrupt.\n";
+        return NULL;
+    }
+    std::vector<t_vertex_id> sizes(cluster_count);
+    std::vector<t_vertex_id> vertices(vertex_count);
+    in.read((char*) &sizes[0], cluster_count * sizeof(t_vertex_id));
+    in.read((char*) &vertices[0], vertex_count * sizeof(t_vertex_id));
+    if (!in) {
+        std::cerr << "Checkpoint file is incomplete.\n";
+        return NULL;
+    }
+
+    // every vertex has to be in exactly one cluster
+    std::vector<bool> assigned(vertex_count, false);
+    Partition* clusters = new Partition();
+    size_t next = 0;
+    for (t_vertex_id i = 0; i < cluster_count; i++) {
+        t_id_list* cluster = new t_id_list();
+        clusters->get_partition_vector()->push_back(cluster);
+        for (t_vertex_id j = 0; j < sizes[i] && next < vertices.size(); j++) {
+            t_vertex_id vertex_id = vertices[next++];
+            if (vertex_id < 0 || vertex_id >= vertex_count ||
+                    assigned[vertex_id]) {
+                next = vertices.size() + 1;
+                break;
+            }
+            assigned[vertex_id] = true;
+            cluster->push_back(graph->GetInternalId(vertex_id));
+        }
+    }
+    if (next != vertices.size()) {
+        std::cerr << "Checkpoint file is corrupt.\n";
+        delete clusters;
+        return NULL;
+    }
+    clusters->RemoveEmptyEntries();
+    return clusters;
+}
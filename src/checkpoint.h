@@ -0,0 +1,48 @@
+//============================================================================
+// Name        : Checkpoint.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : state of a CGGC/CGGCi run between two phases, written to a
+//               binary file so that a preempted run can be resumed
+//============================================================================
+
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <string>
+
+#include "indextypes.h"
+#include "randomsource.h"
+
+class Graph;
+class Partition;
+
+/*
+ * stages of ClusterCGGC after which a checkpoint is written
+ */
+enum CheckpointStage {
+    kEnsembleStage = 1,    // progress: number of ensemble members done
+    kIterationStage = 2    // progress: number of CGGCi iterations done
+};
+
+static const int kEnsembleKeySize = 64;
+
+struct CGGCCheckpoint {
+    int32_t ensemble_size;
+    int32_t iterative;
+    int32_t stage;
+    int32_t progress;
+    double cur_q;       // Q of the core groups
+    double last_q;      // Q of the core groups before the last iteration
+    RandomSourceState random_state;
+    char ensemble_key[kEnsembleKeySize]; // options and seed of the ensemble
+};
+
+bool StoreCheckpoint(std::string filename, Graph* graph,
+        CGGCCheckpoint* checkpoint, Partition* clusters);
+Partition* LoadCheckpoint(std::string filename, Graph* graph,
+        CGGCCheckpoint* checkpoint);
+
+#endif /* CHECKPOINT_H_ */
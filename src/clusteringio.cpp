@@ -0,0 +1,284 @@
+//============================================================================
+// Name        : ClusteringIO.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : writing detected clusterings to file and reading them back
+//============================================================================
+
+
+#include "clusteringio.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <ctype.h>
+#include <stdlib.h>
+
+#include <boost/unordered_map.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+#include <boost/foreach.hpp>
+
+#include "graph.h"
+#include "partition.h"
+
+/*
+ * returns the 1-based id of the cluster of every vertex, -1 for vertices
+ * not contained in the partition. Vertices are given in the order of the
+ * graph file, also if the graph has been relabeled.
+ */
+std::vector<t_vertex_id>* GetClusterAssignments(Partition* clusters,
+        Graph* graph) {
+    std::vector<t_vertex_id>* assingments =
+            new std::vector<t_vertex_id>(graph->get_vertex_count(), -1);
+    for (size_t i = 0; i < clusters->get_partition_vector()->size(); i++) {
+        BOOST_FOREACH(t_vertex_id vertex_id,
+                      *(clusters->get_partition_vector()->at(i)) ) {
+            (*assingments)[graph->GetOriginalId(vertex_id)] = i + 1;
+        }    
+    }
+    return assingments;
+}
+
+bool IsValidOutputFormat(std::string format) {
+    return format == "text" || format == "binary" || format == "clusters";
+}
+
+/*
+ * files with the extension .gz are read and written through gzip
+ */
+static bool IsCompressedFile(std::string filename) {
+    return filename.size() > 3 &&
+            filename.compare(filename.size() - 3, 3, ".gz") == 0;
+}
+
+/*
+ * writes the decimal representation of value followed by separator to pos,
+ * returns the position behind it
+ */
+static char* FormatNumber(char* pos, long long value, char separator) {
+    char digits[24];
+    int count = 0;
+    bool negative = value < 0;
+    unsigned long long rest = negative ? -(unsigned long long) value : value;
+    do {
+        digits[count++] = '0' + rest % 10;
+        rest /= 10;
+    } while (rest > 0);
+
+    if (negative) *pos++ = '-';
+    while (count > 0) *pos++ = digits[--count];
+    *pos++ = separator;
+    return pos;
+}
+
+/*
+ * text lines are formatted into a block buffer which is written when full,
+ * this is much faster than one operator<< per line
+ */
+class BlockWriter {
+public:
+    BlockWriter(std::ostream* out) : out_(out), buffer_(1 << 20), pos_(0) {
+    }
+
+    ~BlockWriter() {
+        Flush();
+    }
+
+    void Write(long long value, char separator) {
+        if (pos_ + 24 > buffer_.size()) Flush();
+        pos_ = FormatNumber(&buffer_[pos_], value, separator) - &buffer_[0];
+    }
+
+    void Flush() {
+        out_->write(&buffer_[0], pos_);
+        pos_ = 0;
+    }
+
+private:
+    std::ostream* out_;
+    std::vector<char> buffer_;
+    size_t pos_;
+};
+
+/*
+ * text: one line per vertex with the 1-based id of its cluster
+ */
+static void WriteAssignmentText(std::ostream* out,
+        std::vector<t_vertex_id>* assingments) {
+    BlockWriter writer(out);
+    for (size_t i = 0; i < assingments->size(); i++)
+        writer.Write((*assingments)[i], '\n');
+}
+
+/*
+ * binary: the cluster ids of the text format as one array of t_vertex_id
+ * (int32 unless built with RGMC_64BIT_VERTEX_IDS) in host byte order, written
+ * with a single call so the file can be mapped into memory directly
+ */
+static void WriteAssignmentBinary(std::ostream* out,
+        std::vector<t_vertex_id>* assingments) {
+    if (assingments->empty()) return;
+    out->write(reinterpret_cast<const char*> (&(*assingments)[0]),
+            assingments->size() * sizeof(t_vertex_id));
+}
+
+/*
+ * clusters: one line per cluster with the sorted 1-based ids of its vertices
+ * as used in the graph file, separated by spaces
+ */
+static void WriteClusterLists(std::ostream* out,
+        std::vector<t_vertex_id>* assingments) {
+    // counting sort of the vertices by cluster, vertices stay sorted by id
+    t_vertex_id cluster_count = 0;
+    for (size_t i = 0; i < assingments->size(); i++)
+        cluster_count = std::max(cluster_count, (*assingments)[i]);
+
+    std::vector<size_t> offsets(cluster_count + 2, 0);
+    for (size_t i = 0; i < assingments->size(); i++)
+        if ((*assingments)[i] > 0)
+            offsets[(*assingments)[i] + 1]++;
+    for (t_vertex_id i = 1; i <= cluster_count + 1; i++)
+        offsets[i] += offsets[i - 1];
+
+    std::vector<t_vertex_id> members(offsets[cluster_count + 1]);
+    for (size_t i = 0; i < assingments->size(); i++)
+        if ((*assingments)[i] > 0)
+            members[offsets[(*assingments)[i]]++] = i;
+
+    BlockWriter writer(out);
+    size_t first = 0;
+    for (t_vertex_id i = 1; i <= cluster_count; i++) {
+        for (size_t j = first; j < offsets[i]; j++)
+            writer.Write((long long) members[j] + 1,
+                    j + 1 < offsets[i] ? ' ' : '\n');
+        first = offsets[i];
+    }
+}
+
+/*
+ * writes the clustering in the given format (see IsValidOutputFormat),
+ * compressed with gzip if the file name ends with .gz
+ */
+bool StoreClustering(std::string out_filename, Partition* final_clusters,
+        Graph* graph, std::string format) {
+    std::vector<t_vertex_id>* assingments =
+            GetClusterAssignments(final_clusters, graph);
+    bool success = StoreAssignments(out_filename, assingments, format);
+    delete assingments;
+    return success;
+}
+
+/*
+ * writes 1-based cluster ids of the vertices in the order of the graph file
+ * (see GetClusterAssignments) in the given format, empty clusters are skipped
+ * by the clusters format
+ */
+bool StoreAssignments(std::string out_filename,
+        std::vector<t_vertex_id>* assingments, std::string format) {
+    std::ofstream file(out_filename.data(),
+            std::ios_base::out | std::ios_base::binary);
+    if (!file) {
+        std::cerr << "Cannot open output file.\n";
+        return false;
+    }
+
+    boost::iostreams::filtering_ostream compressed;
+    std::ostream* out = &file;
+    if (IsCompressedFile(out_filename)) {
+        compressed.push(boost::iostreams::gzip_compressor());
+        compressed.push(file);
+        out = &compressed;
+    }
+
+    if (format == "clusters")
+        WriteClusterLists(out, assingments);
+    else if (format == "binary")
+        WriteAssignmentBinary(out, assingments);
+    else
+        WriteAssignmentText(out, assingments);
+
+    compressed.reset(); // flushes the compressor into the file
+    file.close();
+    if (!file) {
+        std::cerr << "Cannot write output file.\n";
+        return false;
+    }
+    return true;
+}
+
+/*
+ * reads a clustering in the text format written by StoreClustering, i.e. one
+ * line per vertex with the id of its cluster, gzip compressed if the file
+ * name ends with .gz. Vertices with a negative cluster id become singletons.
+ * Returns NULL if a line holds no cluster id or the file does not match the
+ * graph.
+ */
+Partition* LoadClustering(std::string in_filename, Graph* graph) {
+    std::ifstream file(in_filename.data(),
+            std::ios_base::in | std::ios_base::binary);
+    if (!file) {
+        std::cerr << "Cannot open partition file.\n";
+        return NULL;
+    }
+
+    boost::iostreams::filtering_istream in;
+    if (IsCompressedFile(in_filename))
+        in.push(boost::iostreams::gzip_decompressor());
+    in.push(file);
+
+    Partition* partition = new Partition();
+    t_partition* clusters = partition->get_partition_vector();
+    boost::unordered_map<t_vertex_id, t_vertex_id> cluster_index; // file id -> index
+
+    std::string line;
+    t_vertex_id vertex_id = 0;
+    size_t line_number = 0;
+    while (getline(in, line)) {
+        line_number++;
+        if (line.empty() || line == "\r")
+            continue;
+        if (vertex_id >= graph->get_vertex_count()) {
+            std::cerr << "Partition file has more entries than the graph has vertices.\n";
+            delete partition;
+            return NULL;
+        }
+
+        // lines are in the order of the graph file
+        t_vertex_id internal_id = graph->GetInternalId(vertex_id);
+        char* end;
+        long long value = strtoll(line.data(), &end, 10);
+        bool valid = end != line.data() && isdigit((unsigned char) end[-1]);
+        while (isspace((unsigned char) *end))
+            end++;
+        t_vertex_id cluster_id = (t_vertex_id) value;
+        if (!valid || *end != '\0' || cluster_id != value) {
+            std::cerr << "Partition file has no valid cluster id in line "
+                    << line_number << ".\n";
+            delete partition;
+            return NULL;
+        }
+        if (cluster_id < 0) {
+            clusters->push_back(new t_id_list(1, internal_id));
+        } else {
+            boost::unordered_map<t_vertex_id, t_vertex_id>::iterator iter =
+                    cluster_index.find(cluster_id);
+            if (iter == cluster_index.end()) {
+                cluster_index[cluster_id] = clusters->size();
+                clusters->push_back(new t_id_list(1, internal_id));
+            } else
+                clusters->at(iter->second)->push_back(internal_id);
+        }
+        vertex_id++;
+    }
+
+    if (vertex_id != graph->get_vertex_count()) {
+        std::cerr << "Partition file has fewer entries than the graph has vertices.\n";
+        delete partition;
+        return NULL;
+    }
+    return partition;
+}
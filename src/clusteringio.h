@@ -0,0 +1,30 @@
+//============================================================================
+// Name        : ClusteringIO.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : writing detected clusterings to file and reading them back
+//============================================================================
+
+
+#ifndef CLUSTERINGIO_H_
+#define CLUSTERINGIO_H_
+
+#include <string>
+#include <vector>
+
+#include "indextypes.h"
+
+class Graph;
+class Partition;
+
+std::vector<t_vertex_id>* GetClusterAssignments(Partition* clusters,
+        Graph* graph);
+bool IsValidOutputFormat(std::string format);
+bool StoreClustering(std::string out_filename, Partition* final_clusters,
+        Graph* graph, std::string format = "text");
+bool StoreAssignments(std::string out_filename,
+        std::vector<t_vertex_id>* assingments, std::string format = "text");
+Partition* LoadClustering(std::string in_filename, Graph* graph);
+
+#endif /* CLUSTERINGIO_H_ */
@@ -0,0 +1,355 @@
+//============================================================================
+// Name        : ClusteringJob.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : parameters of a single clustering run and the code to run it,
+//               shared by the command line program and the batch driver
+//============================================================================
+
+
+#include "clusteringjob.h"
+
+#include <math.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+#include "modoptimizer.h"
+#include "graph.h"
+#include "partition.h"
+#include "clusteringio.h"
+#include "walltime.h"
+#include "vertexorder.h"
+#include "dendrogram.h"
+
+namespace po = boost::program_options;
+
+static const double kBytesPerMB = 1024.0 * 1024.0;
+
+/*
+ * adds the options describing a clustering run, used for the command line
+ * as well as for the lines of a batch manifest
+ */
+void AddClusteringOptions(po::options_description* desc, ClusteringJob* job) {
+    desc->add_options()
+            ("file", po::value<std::string > (&job->filename), "input graph file")
+            ("k", po::value<int>(&job->k)->default_value(2), "sample size of RG")
+            ("finalk", po::value<int>(&job->finalk)->default_value(2000), "sample size for final RG step")
+            ("runs", po::value<int>(&job->runs)->default_value(1), "number of runs from which to pick the best result")
+            ("ensemblesize", po::value<int>(&job->ensemblesize)->default_value(-1), "size of ensemble for ensemble algorithms (-1 = ln(#vertices))")
+            ("algorithm", po::value<int>(&job->algorithm)->default_value(1), "algorithm: 1: RG, 2: CGGC_RG, 3: CGGCi_RG, 4: multilevel local moving")
+            ("ensemblebase", po::value<std::string> (&job->ensemble_base)->default_value("rg"), "algorithm for the ensemble members of CGGC: rg: RG, lm: multilevel local moving")
+            ("fold-pendants", po::bool_switch(&job->fold_pendants), "start RG with every vertex of degree 1 in the cluster of its neighbor")
+            ("multijoin", po::bool_switch(&job->multi_join), "RG executes a matching of disjoint joins per round instead of one join per step")
+            ("reorder", po::value<std::string> (&job->vertex_order)->default_value("none"), "relabel the vertices after loading for better memory locality: none, degree, bfs, rcm (results use the ids of the file)")
+            ("compress-graph", po::bool_switch(&job->compress_graph), "store the neighbor lists varint coded, needs 2-4x less memory for the graph")
+            ("outfile", po::value<std::string> (&job->out_filename), "file to store the detected communities, gzip compressed if the name ends with .gz")
+            ("outformat", po::value<std::string> (&job->out_format)->default_value("text"), "format of the output file: text: cluster id per vertex, binary: cluster ids as raw integers, clusters: vertices per cluster")
+            ("dendrogram", po::value<std::string> (&job->dendrogram_filename), "file to store all joins of the final RG step with Q after every join (binary), see --cut")
+            ("seed", po::value<int> (&job->seed), "seed value to initialize random number generator")
+            ("time-limit", po::value<double> (&job->time_limit)->default_value(0), "time limit for clustering in seconds, the best result found so far is returned (0 = no limit)")
+            ("checkpoint", po::value<std::string> (&job->checkpoint_filename), "file to save the state of CGGC_RG/CGGCi_RG to after every ensemble member and iteration")
+            ("resume", po::bool_switch(&job->resume), "continue from the state in the --checkpoint file if it exists")
+            ("ensemble-cache", po::value<std::string> (&job->ensemble_cache), "directory to store the core groups of CGGC_RG/CGGCi_RG in, later runs on the same graph with the same ensemble options and seed load them instead of building the ensemble")
+            ("perf-counters", po::bool_switch(&job->perf_counters), "count cycles, instructions, cache, branch and TLB misses per phase (perf_event_open)")
+            ("memory-limit", po::value<double> (&job->memory_limit)->default_value(0), "memory limit for the graph and the clustering in MB, fails early if the estimate exceeds it (0 = no limit)")
+            ("initpartition", po::value<std::string> (&job->init_filename), "file with a clustering in the output format to start from")
+            ("initmode", po::value<std::string> (&job->init_mode)->default_value("restart"), "use of the initial partition: restart: skip the ensemble and run only the final RG step, ensemble: use it as ensemble member (CGGC only)")
+            ;
+}
+
+/*
+ * sets the fields of the job that can not be bound to an option directly
+ */
+void ReadClusteringOptions(po::variables_map* vm, ClusteringJob* job) {
+    job->has_seed = vm->count("seed") > 0;
+}
+
+bool IsValidAlgorithm(int algorithm) {
+    return algorithm >= 1 && algorithm <= 4;
+}
+
+bool IsValidEnsembleBase(std::string ensemble_base) {
+    return ensemble_base == "rg" || ensemble_base == "lm";
+}
+
+/*
+ * same check Graph::LoadFromFile uses to select the file format
+ */
+bool IsSupportedGraphFile(std::string filename) {
+    return filename.rfind(".graph") != std::string::npos ||
+            filename.rfind(".net") != std::string::npos;
+}
+
+/*
+ * loads the graph of the job and relabels it in the requested vertex order
+ */
+Graph* LoadJobGraph(ClusteringJob* job) {
+    Graph* graph = new Graph(job->filename, job->compress_graph);
+    ReorderGraph(graph, job->vertex_order);
+    FitGraphToMemoryLimit(graph, job);
+    return graph;
+}
+
+/*
+ * jobs with the same key can share one loaded graph. The memory limit is part
+ * of the key as it decides whether LoadJobGraph compresses the graph.
+ */
+std::string GetGraphKey(ClusteringJob* job) {
+    std::ostringstream key;
+    key << job->filename;
+    if (job->vertex_order != "none")
+        key << " --reorder=" << job->vertex_order;
+    if (job->compress_graph)
+        key << " --compress-graph";
+    else if (job->memory_limit > 0)
+        key << " --memory-limit=" << job->memory_limit;
+    return key.str();
+}
+
+/*
+ * every option that changes the ensemble of a job and the seed, e.g.
+ * e9.rg.fold.seed1 (see ModOptimizer::SetEnsembleKey)
+ */
+std::string GetEnsembleKey(ClusteringJob* job, int ensemblesize,
+        unsigned int seed) {
+    std::ostringstream key;
+    key << "e" << ensemblesize << "." << job->ensemble_base;
+    if (job->fold_pendants)
+        key << ".fold";
+    if (job->multi_join)
+        key << ".multijoin";
+    key << ".seed" << seed;
+    return key.str();
+}
+
+/*
+ * name of the cache files (without extension, see
+ * ModOptimizer::SetEnsembleCache) of the ensemble of a job, built from the
+ * graph content and the ensemble key
+ */
+std::string GetEnsembleCacheName(ClusteringJob* job, Graph* graph,
+        int ensemblesize, unsigned int seed) {
+    std::ostringstream name;
+    name << job->ensemble_cache << "/" << std::hex << std::setw(16)
+            << std::setfill('0') << graph->GetContentHash() << std::dec
+            << "." << GetEnsembleKey(job, ensemblesize, seed);
+    return name.str();
+}
+
+/*
+ * runs the algorithm selected by the job, the result is available from
+ * optimizer->GetClusters() afterwards. Returns false if the initial partition
+ * can not be used or the memory limit is too low for the graph.
+ */
+bool RunClustering(ModOptimizer* optimizer, Graph* graph, ClusteringJob* job) {
+    unsigned int seed;
+    if (job->has_seed) {
+        seed = (unsigned int) job->seed;
+    } else {
+        time_t t;
+        time(&t);
+        seed = (unsigned int) t;
+    }
+    optimizer->SetSeed(seed);
+
+    if (job->time_limit > 0)
+        optimizer->SetDeadline(GetWallTime() + job->time_limit);
+    optimizer->SetLocalMovingEnsemble(job->ensemble_base == "lm");
+    optimizer->SetPendantFolding(job->fold_pendants);
+    optimizer->SetMultiJoin(job->multi_join);
+    optimizer->SetDendrogramRecording(!job->dendrogram_filename.empty());
+    optimizer->SetCheckpoint(job->checkpoint_filename, job->resume);
+    if (job->perf_counters && !optimizer->EnablePerfCounters())
+        std::cerr << "Performance counters unavailable: "
+                << optimizer->GetPerfCounters()->get_error() << std::endl;
+
+    MemoryEstimate estimate;
+    if (!optimizer->SetMemoryLimit((size_t) (job->memory_limit * kBytesPerMB),
+            &estimate)) {
+        std::cerr << std::setprecision(4) << "Memory limit of "
+                << job->memory_limit << " MB too low, about "
+                << estimate.GetTotal(true) / kBytesPerMB << " MB needed (";
+        for (int i = 0; i < kMemoryItemCount; i++)
+            std::cerr << (i > 0 ? ", " : "") << GetMemoryItemName((MemoryItem) i)
+                    << " " << estimate.bytes[i] / kBytesPerMB;
+        std::cerr << ")." << std::endl;
+        return false;
+    }
+
+    int ensemblesize = job->ensemblesize;
+    if (ensemblesize == -1) ensemblesize = log(graph->get_vertex_count());
+    optimizer->SetEnsembleKey(GetEnsembleKey(job, ensemblesize, seed));
+    if (!job->ensemble_cache.empty() && job->init_filename.empty() &&
+            (job->algorithm == 2 || job->algorithm == 3)) {
+        mkdir(job->ensemble_cache.data(), 0777); // may exist already
+        optimizer->SetEnsembleCache(GetEnsembleCacheName(job, graph,
+                ensemblesize, seed));
+    }
+
+    Partition* initial_partition = NULL;
+    if (!job->init_filename.empty()) {
+        if (job->init_mode != "restart" && (job->init_mode != "ensemble" ||
+                job->algorithm == 1)) {
+            std::cerr << "Invalid parameter for '--initmode'." << std::endl;
+            return false;
+        }
+
+        initial_partition = LoadClustering(job->init_filename, graph);
+        if (initial_partition == NULL)
+            return false;
+
+        if (job->init_mode == "restart") {
+            optimizer->ClusterWarmStart(initial_partition, job->finalk);
+            delete initial_partition;
+            return true;
+        }
+        optimizer->SetInitialPartition(initial_partition);
+    }
+
+    switch (job->algorithm) {
+        case 1:
+            optimizer->ClusterRG(job->k, job->runs);
+            break;
+        case 2:
+            optimizer->ClusterCGGC(ensemblesize, job->finalk, false);
+            break;
+        case 3:
+            optimizer->ClusterCGGC(ensemblesize, job->finalk, true);
+            break;
+        case 4:
+            optimizer->ClusterLocalMoving(job->runs);
+            break;
+    }
+
+    optimizer->SetInitialPartition(NULL);
+    delete initial_partition;
+    return true;
+}
+
+/*
+ * stores the dendrogram of the clustering if the job asks for it, fails if
+ * the algorithm has no join phase (local moving)
+ */
+bool StoreJobDendrogram(ModOptimizer* optimizer, ClusteringJob* job) {
+    if (job->dendrogram_filename.empty())
+        return true;
+    if (optimizer->GetDendrogram() == NULL) {
+        std::cerr << "No dendrogram: the result does not come from RG joins."
+                << std::endl;
+        return false;
+    }
+    return optimizer->GetDendrogram()->Store(job->dendrogram_filename);
+}
+
+/*
+ * returns "  cut short: <phase>,<phase>" if phases were stopped by the time
+ * limit, an empty string otherwise
+ */
+std::string GetTruncationReport(ModOptimizer* optimizer) {
+    vector<string>* phases = optimizer->GetTruncatedPhases();
+    if (phases->empty())
+        return "";
+
+    std::string report = "  cut short: ";
+    for (size_t i = 0; i < phases->size(); i++) {
+        if (i > 0) report += ",";
+        report += phases->at(i);
+    }
+    return report;
+}
+
+/*
+ * one line per phase with the counters and their rates per join and per edge
+ * and the peak RSS and CPU time, an empty string if the counters are not
+ * enabled
+ */
+std::string GetCounterReport(ModOptimizer* optimizer, Graph* graph) {
+    PerfCounters* perf_counters = optimizer->GetPerfCounters();
+    if (perf_counters == NULL)
+        return "";
+
+    std::ostringstream report;
+    report << std::setprecision(4);
+    vector<PhaseCounters>* phases = optimizer->GetPhaseCounters();
+    for (size_t i = 0; i < phases->size(); i++) {
+        PhaseCounters& phase = phases->at(i);
+        report << "phase: " << phase.phase << "  time [sec]: " << phase.time
+                << "  joins: " << phase.joins;
+        for (int j = 0; j < kPerfCounterCount; j++)
+            if (perf_counters->IsAvailable((PerfCounter) j))
+                report << "  " << PerfCounters::GetName((PerfCounter) j)
+                        << ": " << (double) phase.values[j];
+        if (perf_counters->IsAvailable(kCycles) &&
+                perf_counters->IsAvailable(kInstructions) &&
+                phase.values[kCycles] > 0)
+            report << "  IPC: " << (double) phase.values[kInstructions] /
+                    phase.values[kCycles];
+
+        for (int rate = 0; rate < 2; rate++) {
+            double count = rate == 0 ? phase.joins : graph->get_edge_count();
+            if (count <= 0 || !perf_counters->IsAnyAvailable()) continue;
+            report << (rate == 0 ? "  per join:" : "  per edge:");
+            for (int j = 0; j < kPerfCounterCount; j++)
+                if (perf_counters->IsAvailable((PerfCounter) j))
+                    report << " " << PerfCounters::GetName((PerfCounter) j)
+                            << " " << phase.values[j] / count;
+        }
+        report << "\n";
+    }
+
+    // high water mark and user + system time of all threads of the process,
+    // in batch mode over all jobs so far
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        report << "peak RSS [MB]: " << usage.ru_maxrss / 1024.0
+                << "  CPU [sec]: " << usage.ru_utime.tv_sec +
+                usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec +
+                usage.ru_stime.tv_usec) / 1e6 << "\n";
+    return report.str();
+}
+
+/*
+ * compresses the graph if the memory limit of the job can not be kept with
+ * plain neighbor lists even if the clustering structures are released after
+ * every use (see ModOptimizer::SetMemoryLimit)
+ */
+void FitGraphToMemoryLimit(Graph* graph, ClusteringJob* job) {
+    if (job->memory_limit <= 0 || graph->IsCompressed())
+        return;
+
+    size_t limit = (size_t) (job->memory_limit * kBytesPerMB);
+    MemoryEstimate estimate = EstimateMemory(graph->get_vertex_count(),
+            graph->get_edge_count(), false);
+    estimate.bytes[kGraphMemory] = graph->GetMemoryBytes();
+    if (estimate.GetTotal(true) > limit)
+        graph->Compress();
+}
+
+/*
+ * one line per phase with the peak bytes of the graph and the clustering
+ * structures, an empty string if they were not recorded (see
+ * ModOptimizer::GetPhaseMemory)
+ */
+std::string GetMemoryReport(ModOptimizer* optimizer, ClusteringJob* job) {
+    vector<PhaseMemory>* phases = optimizer->GetPhaseMemory();
+    std::ostringstream report;
+    report << std::setprecision(4);
+    for (size_t i = 0; i < phases->size(); i++) {
+        PhaseMemory& phase = phases->at(i);
+        report << "memory: " << phase.phase;
+        for (int j = 0; j < kMemoryItemCount; j++)
+            report << "  " << GetMemoryItemName((MemoryItem) j) << " [MB]: "
+                    << phase.peak[j] / kBytesPerMB;
+        report << "  total [MB]: " << phase.peak_total / kBytesPerMB << "\n";
+    }
+    if (optimizer->IsMemoryLimitExceeded())
+        report << "memory limit of " << job->memory_limit
+                << " MB exceeded, the phases listed as cut short were stopped\n";
+    return report.str();
+}
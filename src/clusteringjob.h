@@ -0,0 +1,68 @@
+//============================================================================
+// Name        : ClusteringJob.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : parameters of a single clustering run and the code to run it,
+//               shared by the command line program and the batch driver
+//============================================================================
+
+
+#ifndef CLUSTERINGJOB_H_
+#define CLUSTERINGJOB_H_
+
+#include <string>
+
+#include <boost/program_options.hpp>
+
+class Graph;
+class ModOptimizer;
+
+struct ClusteringJob {
+    std::string filename;
+    std::string out_filename;
+    std::string out_format;
+    std::string init_filename;
+    std::string init_mode;
+    std::string ensemble_base;
+    std::string vertex_order;
+    std::string dendrogram_filename;
+    std::string checkpoint_filename;
+    std::string ensemble_cache;
+    int k;
+    int finalk;
+    int runs;
+    int ensemblesize;
+    int algorithm;
+    int seed;
+    bool has_seed;
+    double time_limit;
+    bool fold_pendants;
+    bool multi_join;
+    bool resume;
+    bool perf_counters;
+    bool compress_graph;
+    double memory_limit;
+};
+
+void AddClusteringOptions(boost::program_options::options_description* desc,
+        ClusteringJob* job);
+void ReadClusteringOptions(boost::program_options::variables_map* vm,
+        ClusteringJob* job);
+bool IsValidAlgorithm(int algorithm);
+bool IsValidEnsembleBase(std::string ensemble_base);
+bool IsSupportedGraphFile(std::string filename);
+Graph* LoadJobGraph(ClusteringJob* job);
+std::string GetGraphKey(ClusteringJob* job);
+std::string GetEnsembleKey(ClusteringJob* job, int ensemblesize,
+        unsigned int seed);
+std::string GetEnsembleCacheName(ClusteringJob* job, Graph* graph,
+        int ensemblesize, unsigned int seed);
+bool RunClustering(ModOptimizer* optimizer, Graph* graph, ClusteringJob* job);
+bool StoreJobDendrogram(ModOptimizer* optimizer, ClusteringJob* job);
+std::string GetTruncationReport(ModOptimizer* optimizer);
+std::string GetCounterReport(ModOptimizer* optimizer, Graph* graph);
+void FitGraphToMemoryLimit(Graph* graph, ClusteringJob* job);
+std::string GetMemoryReport(ModOptimizer* optimizer, ClusteringJob* job);
+
+#endif /* CLUSTERINGJOB_H_ */
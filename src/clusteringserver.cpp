@@ -0,0 +1,333 @@
+//============================================================================
+// Name        : ClusteringServer.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : keeps graphs in memory and answers clustering requests
+//               received over a UNIX domain socket
+//============================================================================
+
+
+#include "clusteringserver.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <iostream>
+#include <sstream>
+
+#include <boost/tokenizer.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "clusteringio.h"
+#include "vertexorder.h"
+#include "clusteringjob.h"
+#include "modoptimizer.h"
+#include "graph.h"
+#include "partition.h"
+#include "walltime.h"
+
+namespace po = boost::program_options;
+
+ClusteringServer::ClusteringServer(std::string socket_path,
+        std::string output_directory) {
+    socket_path_ = socket_path;
+    output_directory_ = output_directory;
+    listen_fd_ = -1;
+}
+
+ClusteringServer::~ClusteringServer() {
+    if (listen_fd_ != -1) {
+        close(listen_fd_);
+        unlink(socket_path_.data());
+    }
+}
+
+/*
+ * accepts connections until the process is terminated, every connection is
+ * served by its own thread
+ */
+int ClusteringServer::Run() {
+    sockaddr_un address;
+    if (socket_path_.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long." << std::endl;
+        return 1;
+    }
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ == -1) {
+        std::cerr << "Could not create socket: " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path_.data());
+
+    // remove the socket of an earlier run, but never another kind of file
+    struct stat status;
+    if (lstat(socket_path_.data(), &status) == 0) {
+        if (!S_ISSOCK(status.st_mode)) {
+            std::cerr << socket_path_ << " exists and is not a socket."
+                    << std::endl;
+            return 1;
+        }
+        unlink(socket_path_.data());
+    }
+
+    // only the user running the server may connect
+    mode_t old_mask = umask(0077);
+    int bound = bind(listen_fd_, (sockaddr*) &address, sizeof(address));
+    umask(old_mask);
+    if (bound == -1 || chmod(socket_path_.data(), 0600) == -1 ||
+            listen(listen_fd_, 16) == -1) {
+        std::cerr << "Could not listen on " << socket_path_ << ": "
+                << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    // a client closing its connection early must not terminate the server
+    signal(SIGPIPE, SIG_IGN);
+    std::cout << "Listening on " << socket_path_ << std::endl;
+
+    while (true) {
+        int fd = accept(listen_fd_, NULL, NULL);
+        if (fd == -1) {
+            if (errno == EINTR) continue;
+            std::cerr << "accept failed: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        boost::thread(&ClusteringServer::HandleConnection, this, fd).detach();
+    }
+    return 0;
+}
+
+/*
+ * reads requests line by line and writes the response of each request
+ * before reading the next one
+ */
+void ClusteringServer::HandleConnection(int fd) {
+    std::string buffer;
+    char chunk[4096];
+    bool close_connection = false;
+
+    while (!close_connection) {
+        size_t newline = buffer.find('\n');
+        if (newline == std::string::npos) {
+            ssize_t count = read(fd, chunk, sizeof(chunk));
+            if (count == -1 && errno == EINTR) continue;
+            if (count <= 0) break;
+            buffer.append(chunk, count);
+            continue;
+        }
+
+        std::string request = buffer.substr(0, newline);
+        buffer.erase(0, newline + 1);
+
+        std::string response = HandleRequest(request, &close_connection);
+        size_t written = 0;
+        while (written < response.size()) {
+            ssize_t count = write(fd, response.data() + written,
+                    response.size() - written);
+            if (count == -1 && errno == EINTR) continue;
+            if (count <= 0) {
+                close_connection = true;
+                break;
+            }
+            written += count;
+        }
+    }
+    close(fd);
+}
+
+/*
+ * supported requests, options are given as on the command line:
+ *   CLUSTER --file=<path> [--algorithm=.. --k=.. --finalk=.. --seed=..]
+ *   LOAD --file=<path>
+ *   UNLOAD --file=<path>
+ *   QUIT
+ * every response starts with a line "OK ..." or "ERROR <message>", a
+ * CLUSTER response is followed by one line with the 1-based cluster ids of
+ * all vertices
+ */
+std::string ClusteringServer::HandleRequest(std::string request,
+        bool* close_connection) {
+    boost::char_separator<char> sep(" \t\r");
+    boost::tokenizer<boost::char_separator<char> > tokens(request, sep);
+    std::vector<std::string> args(tokens.begin(), tokens.end());
+
+    if (args.empty())
+        return "ERROR empty request\n";
+
+    std::string command = args[0];
+    args.erase(args.begin());
+
+    if (command == "QUIT") {
+        *close_connection = true;
+        return "OK\n";
+    }
+    if (command == "CLUSTER")
+        return Cluster(&args);
+
+    if (command != "LOAD" && command != "UNLOAD")
+        return "ERROR unknown command " + command + "\n";
+
+    ClusteringJob job;
+    po::options_description desc;
+    AddClusteringOptions(&desc, &job);
+    try {
+        po::variables_map vm;
+        po::store(po::command_line_parser(args).options(desc).run(), vm);
+        po::notify(vm);
+    } catch (po::error& e) {
+        return std::string("ERROR ") + e.what() + "\n";
+    }
+
+    std::ostringstream response;
+    if (command == "UNLOAD") {
+        if (!UnloadGraph(&job))
+            return "ERROR graph not loaded\n";
+        return "OK\n";
+    }
+
+    double start = GetWallTime();
+    boost::shared_ptr<Graph> graph = GetGraph(&job);
+    if (!graph)
+        return "ERROR graph could not be loaded\n";
+
+    response << "OK vertices: " << graph->get_vertex_count()
+            << "  edges: " << graph->get_edge_count()
+            << "  load [sec]: " << GetWallTime() - start << "\n";
+    return response.str();
+}
+
+/*
+ * Files written for a request (--outfile, --dendrogram, --checkpoint,
+ * --ensemble-cache) are only allowed if the server has an output directory.
+ * They have to be plain names and are placed in that directory. Returns
+ * false if the name is not allowed.
+ */
+bool ClusteringServer::PlaceOutputFile(std::string* filename) {
+    if (filename->empty())
+        return true;
+    if (output_directory_.empty() || *filename == "." || *filename == ".." ||
+            filename->find('/') != std::string::npos)
+        return false;
+    *filename = output_directory_ + "/" + *filename;
+    return true;
+}
+
+std::string ClusteringServer::Cluster(std::vector<std::string>* args) {
+    ClusteringJob job;
+    po::options_description desc;
+    AddClusteringOptions(&desc, &job);
+    try {
+        po::variables_map vm;
+        po::store(po::command_line_parser(*args).options(desc).run(), vm);
+        po::notify(vm);
+        ReadClusteringOptions(&vm, &job);
+    } catch (po::error& e) {
+        return std::string("ERROR ") + e.what() + "\n";
+    }
+
+    if (!IsValidAlgorithm(job.algorithm))
+        return "ERROR invalid parameter for --algorithm\n";
+    if (!IsValidEnsembleBase(job.ensemble_base))
+        return "ERROR invalid parameter for --ensemblebase\n";
+    if (!IsValidOutputFormat(job.out_format))
+        return "ERROR invalid parameter for --outformat\n";
+    if (!IsValidVertexOrder(job.vertex_order))
+        return "ERROR invalid parameter for --reorder\n";
+    if (!PlaceOutputFile(&job.out_filename) ||
+            !PlaceOutputFile(&job.dendrogram_filename) ||
+            !PlaceOutputFile(&job.checkpoint_filename) ||
+            !PlaceOutputFile(&job.ensemble_cache))
+        return "ERROR output files need --server-outdir and a name without "
+                "a directory\n";
+
+    boost::shared_ptr<Graph> graph = GetGraph(&job);
+    if (!graph)
+        return "ERROR graph could not be loaded\n";
+
+    ModOptimizer gclusterer(graph.get());
+    double start = GetWallTime();
+    if (!RunClustering(&gclusterer, graph.get(), &job))
+        return "ERROR initial partition could not be used or memory limit too low\n";
+    double time = GetWallTime() - start;
+
+    Partition* final_clusters = gclusterer.GetClusters();
+    double Q = gclusterer.GetModularityFromClustering(graph.get(),
+            final_clusters);
+    if (!job.out_filename.empty() && !StoreClustering(job.out_filename,
+            final_clusters, graph.get(), job.out_format))
+        return "ERROR clustering could not be stored\n";
+    if (!StoreJobDendrogram(&gclusterer, &job))
+        return "ERROR dendrogram could not be stored\n";
+
+    std::vector<t_vertex_id>* assingments =
+            GetClusterAssignments(final_clusters, graph.get());
+
+    std::ostringstream response;
+    response << "OK Q: " << Q
+            << "  clusters: " << final_clusters->get_partition_vector()->size()
+            << "  time [sec]: " << time
+            << GetTruncationReport(&gclusterer) << "\n";
+    for (size_t i = 0; i < assingments->size(); i++) {
+        if (i > 0) response << " ";
+        response << (*assingments)[i];
+    }
+    response << "\n";
+
+    delete assingments;
+    return response.str();
+}
+
+/*
+ * returns the graph of the job in its vertex order, loads it on first use
+ */
+boost::shared_ptr<Graph> ClusteringServer::GetGraph(ClusteringJob* job) {
+    if (job->filename.empty() || !IsSupportedGraphFile(job->filename) ||
+            !IsValidVertexOrder(job->vertex_order))
+        return boost::shared_ptr<Graph>();
+
+    std::string key = GetGraphKey(job);
+
+    boost::shared_ptr<GraphEntry> entry;
+    {
+        boost::unique_lock<boost::mutex> lock(graphs_mutex_);
+        t_graph_cache::iterator iter = graphs_.find(key);
+        if (iter == graphs_.end()) {
+            entry.reset(new GraphEntry());
+            graphs_[key] = entry;
+        } else
+            entry = iter->second;
+    }
+
+    boost::unique_lock<boost::mutex> lock(entry->mutex);
+    if (!entry->graph) {
+        boost::shared_ptr<Graph> graph(LoadJobGraph(job));
+        if (graph->get_vertex_count() < 2) {
+            boost::unique_lock<boost::mutex> lock(graphs_mutex_);
+            t_graph_cache::iterator iter = graphs_.find(key);
+            if (iter != graphs_.end() && iter->second == entry)
+                graphs_.erase(iter);
+            return boost::shared_ptr<Graph>();
+        }
+        entry->graph = graph;
+    }
+    return entry->graph;
+}
+
+/*
+ * removes a graph from the cache, requests still using it keep their copy
+ * until they are finished
+ */
+bool ClusteringServer::UnloadGraph(ClusteringJob* job) {
+    boost::unique_lock<boost::mutex> lock(graphs_mutex_);
+    return graphs_.erase(GetGraphKey(job)) > 0;
+}
@@ -0,0 +1,55 @@
+//============================================================================
+// Name        : ClusteringServer.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : keeps graphs in memory and answers clustering requests
+//               received over a UNIX domain socket
+//============================================================================
+
+
+#ifndef CLUSTERINGSERVER_H_
+#define CLUSTERINGSERVER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+class Graph;
+struct ClusteringJob;
+
+class ClusteringServer {
+public:
+    ClusteringServer(std::string socket_path,
+        std::string output_directory = "");
+    virtual ~ClusteringServer();
+
+    int Run();
+
+private:
+    // a graph is loaded by the first request naming its path (and vertex
+    // order), later requests for it wait on the entry mutex until it is loaded
+    struct GraphEntry {
+        boost::mutex mutex;
+        boost::shared_ptr<Graph> graph;
+    };
+    typedef std::map<std::string, boost::shared_ptr<GraphEntry> > t_graph_cache;
+
+    std::string socket_path_;
+    std::string output_directory_;  // files written for requests, "" = none
+    int listen_fd_;
+    t_graph_cache graphs_;
+    boost::mutex graphs_mutex_;
+
+    void HandleConnection(int fd);
+    std::string HandleRequest(std::string request, bool* close_connection);
+    std::string Cluster(std::vector<std::string>* args);
+    bool PlaceOutputFile(std::string* filename);
+    boost::shared_ptr<Graph> GetGraph(ClusteringJob* job);
+    bool UnloadGraph(ClusteringJob* job);
+};
+
+#endif /* CLUSTERINGSERVER_H_ */
@@ -0,0 +1,167 @@
+//============================================================================
+// Name        : ClusteringWorkspace.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : owns the data structures of the join and refinement phases,
+//               so that consecutive runs reuse their memory instead of
+//               allocating it again
+//============================================================================
+
+
+#include "clusteringworkspace.h"
+
+#include "graph.h"
+#include "partition.h"
+
+// heap block of an entry of a link map (value, hash link and allocator header)
+static const size_t kLinkNodeBytes = 32;
+
+ClusteringWorkspace::ClusteringWorkspace() {
+    links_in_use_ = 0;
+}
+
+ClusteringWorkspace::~ClusteringWorkspace() {
+}
+
+/*
+ * prepares the join phase starting from singleton clusters
+ */
+void ClusteringWorkspace::Reset(Graph* graph) {
+    cluster_matrix_.Reset(graph);
+    active_rows_.Reset(graph->get_vertex_count());
+    joins_.resize(graph->get_vertex_count() - 1);
+}
+
+/*
+ * prepares the join phase starting from the clusters of a partition
+ */
+void ClusteringWorkspace::Reset(Graph* graph, Partition* clusters) {
+    cluster_matrix_.Reset(graph, clusters);
+    active_rows_.Reset(clusters, graph->get_vertex_count());
+    joins_.resize(clusters->get_partition_vector()->size() - 1);
+}
+
+/*
+ * prepares the refinement buffers, the link maps of all vertices are empty
+ * and have the bucket count of new maps afterwards, so the refinement does
+ * not depend on earlier runs
+ */
+void ClusteringWorkspace::ResetRefinement(Graph* graph,
+        t_vertex_id cluster_count) {
+    clusterdegree_.assign(cluster_count, 0);
+    clustermap_.resize(graph->get_vertex_count());
+
+    if ((t_vertex_id) links_.size() < graph->get_vertex_count())
+        links_.resize(graph->get_vertex_count());
+    for (t_vertex_id i = 0; i < links_in_use_; i++) {
+        links_[i].clear();
+        links_[i].rehash(0);
+    }
+    links_in_use_ = graph->get_vertex_count();
+}
+
+/*
+ * number of threads used to build the cluster matrix
+ */
+void ClusteringWorkspace::SetThreads(int threads) {
+    cluster_matrix_.SetThreads(threads);
+}
+
+/*
+ * bytes held by the structures of the join phase
+ */
+size_t ClusteringWorkspace::GetJoinBytes() {
+    return cluster_matrix_.GetMemoryBytes() + active_rows_.GetMemoryBytes() +
+            (joins_.capacity() + ties_.capacity()) * sizeof(t_vertex_pair);
+}
+
+/*
+ * bytes held by the structures of the refinement, the link maps keep their
+ * buckets when they are cleared
+ */
+size_t ClusteringWorkspace::GetRefinementBytes() {
+    size_t bytes = clusterdegree_.capacity() * sizeof(t_edge_count) +
+            clustermap_.capacity() * sizeof(t_vertex_id) +
+            links_.capacity() * sizeof(t_id_id_mapping);
+    for (size_t i = 0; i < links_.size(); i++) {
+        if (links_[i].bucket_count() == 0) continue;
+        bytes += (links_[i].bucket_count() + 1) * sizeof(void*) +
+                links_[i].size() * kLinkNodeBytes;
+    }
+    return bytes;
+}
+
+/*
+ * frees the structures of the join phase, the next Reset allocates them
+ * again
+ */
+void ClusteringWorkspace::ReleaseJoinPhase() {
+    cluster_matrix_.Release();
+    active_rows_.Release();
+    std::vector<t_vertex_pair>().swap(joins_);
+    std::vector<t_vertex_pair>().swap(ties_);
+}
+
+/*
+ * frees the structures of the refinement, the next ResetRefinement
+ * allocates them again
+ */
+void ClusteringWorkspace::ReleaseRefinement() {
+    std::vector<t_edge_count>().swap(clusterdegree_);
+    std::vector<t_vertex_id>().swap(clustermap_);
+    std::vector<t_id_id_mapping>().swap(links_);
+    links_in_use_ = 0;
+}
+
+/*
+ * bytes of the join phase starting from singletons
+ */
+size_t ClusteringWorkspace::EstimateJoinBytes(t_vertex_id vertex_count,
+        t_edge_count edge_count) {
+    return SparseClusteringMatrix::EstimateBytes(vertex_count, edge_count) +
+            (size_t) vertex_count * (2 * sizeof(t_vertex_id) +
+            sizeof(t_vertex_pair));
+}
+
+/*
+ * bytes of the refinement, at most one link per adjacency entry
+ */
+size_t ClusteringWorkspace::EstimateRefinementBytes(t_vertex_id vertex_count,
+        t_edge_count edge_count) {
+    return (size_t) vertex_count * (sizeof(t_edge_count) +
+            sizeof(t_vertex_id) + sizeof(t_id_id_mapping) + 2 * sizeof(void*)) +
+            (size_t) edge_count * 2 * (kLinkNodeBytes + sizeof(void*));
+}
+
+SparseClusteringMatrix* ClusteringWorkspace::get_cluster_matrix() {
+    return &cluster_matrix_;
+}
+
+ActiveRowSet* ClusteringWorkspace::get_active_rows() {
+    return &active_rows_;
+}
+
+std::vector<t_vertex_pair>* ClusteringWorkspace::get_joins() {
+    return &joins_;
+}
+
+std::vector<t_vertex_pair>* ClusteringWorkspace::get_ties() {
+    return &ties_;
+}
+
+DeltaQScanner* ClusteringWorkspace::get_scanner() {
+    return &scanner_;
+}
+
+std::vector<t_edge_count>* ClusteringWorkspace::get_clusterdegree() {
+    return &clusterdegree_;
+}
+
+std::vector<t_vertex_id>* ClusteringWorkspace::get_clustermap() {
+    return &clustermap_;
+}
+
+std::vector<t_id_id_mapping>* ClusteringWorkspace::get_links() {
+    return &links_;
+}
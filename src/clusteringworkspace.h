@@ -0,0 +1,73 @@
+//============================================================================
+// Name        : ClusteringWorkspace.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : owns the data structures of the join and refinement phases,
+//               so that consecutive runs reuse their memory instead of
+//               allocating it again
+//============================================================================
+
+
+#ifndef CLUSTERINGWORKSPACE_H_
+#define CLUSTERINGWORKSPACE_H_
+
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "indextypes.h"
+#include "sparseclusteringmatrix.h"
+#include "activerowset.h"
+#include "deltaqscan.h"
+
+class Graph;
+class Partition;
+
+typedef boost::unordered_map<t_vertex_id, t_vertex_id> t_id_id_mapping;
+
+class ClusteringWorkspace {
+public:
+    ClusteringWorkspace();
+    virtual ~ClusteringWorkspace();
+
+    void Reset(Graph* graph);
+    void Reset(Graph* graph, Partition* clusters);
+    void ResetRefinement(Graph* graph, t_vertex_id cluster_count);
+    void SetThreads(int threads);
+
+    size_t GetJoinBytes();
+    size_t GetRefinementBytes();
+    void ReleaseJoinPhase();
+    void ReleaseRefinement();
+    static size_t EstimateJoinBytes(t_vertex_id vertex_count,
+        t_edge_count edge_count);
+    static size_t EstimateRefinementBytes(t_vertex_id vertex_count,
+        t_edge_count edge_count);
+
+    SparseClusteringMatrix* get_cluster_matrix();
+    ActiveRowSet* get_active_rows();
+    std::vector<t_vertex_pair>* get_joins();
+    std::vector<t_vertex_pair>* get_ties();
+    DeltaQScanner* get_scanner();
+
+    std::vector<t_edge_count>* get_clusterdegree();
+    std::vector<t_vertex_id>* get_clustermap();
+    std::vector<t_id_id_mapping>* get_links();
+
+private:
+    // join phase
+    SparseClusteringMatrix cluster_matrix_;
+    ActiveRowSet active_rows_;
+    std::vector<t_vertex_pair> joins_;
+    std::vector<t_vertex_pair> ties_;   // joins with the best delta Q of a step
+    DeltaQScanner scanner_;
+
+    // refinement phase
+    std::vector<t_edge_count> clusterdegree_;
+    std::vector<t_vertex_id> clustermap_;
+    std::vector<t_id_id_mapping> links_;
+    t_vertex_id links_in_use_;
+};
+
+#endif /* CLUSTERINGWORKSPACE_H_ */
@@ -0,0 +1,186 @@
+//============================================================================
+// Name        : DeltaQScan.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : finds the joins with the highest delta Q in a row of the
+//               cluster matrix. The row is copied into plain arrays and
+//               scanned by a vectorised kernel that is chosen at runtime
+//               (AVX-512, AVX2 or scalar)
+//============================================================================
+
+
+#include "deltaqscan.h"
+
+#include <limits>
+
+#include "sparseclusteringmatrix.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RGMC_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+/*
+ * All kernels compute 2 * (value - row_sum * column_sum) with separate
+ * multiply and subtract, so every kernel returns bit-identical values and
+ * ties are found the same way regardless of the instruction set.
+ */
+static double ScanScalar(const t_vertex_id* columns, const double* values,
+        const double* row_sums, double row_sum, double* delta_q, size_t n) {
+    double max = -std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < n; i++) {
+        double d = 2 * (values[i] - row_sum * row_sums[columns[i]]);
+        delta_q[i] = d;
+        if (d > max) max = d;
+    }
+    return max;
+}
+
+#ifdef RGMC_X86_KERNELS
+
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+static double ScanAvx2(const t_vertex_id* columns, const double* values,
+        const double* row_sums, double row_sum, double* delta_q, size_t n) {
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d a = _mm256_set1_pd(row_sum);
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    __m256d max = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+#ifdef RGMC_64BIT_VERTEX_IDS
+        __m256i index = _mm256_loadu_si256((const __m256i*) (columns + i));
+        __m256d sums = _mm256_mask_i64gather_pd(_mm256_setzero_pd(),
+                row_sums, index, all, 8);
+#else
+        __m128i index = _mm_loadu_si128((const __m128i*) (columns + i));
+        __m256d sums = _mm256_mask_i32gather_pd(_mm256_setzero_pd(),
+                row_sums, index, all, 8);
+#endif
+        __m256d d = _mm256_mul_pd(two,
+                _mm256_sub_pd(_mm256_loadu_pd(values + i),
+                _mm256_mul_pd(a, sums)));
+        _mm256_storeu_pd(delta_q + i, d);
+        max = _mm256_max_pd(max, d);
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, max);
+    double result = lanes[0];
+    for (int j = 1; j < 4; j++)
+        if (lanes[j] > result) result = lanes[j];
+
+    for (; i < n; i++) {
+        double d = 2 * (values[i] - row_sum * row_sums[columns[i]]);
+        delta_q[i] = d;
+        if (d > result) result = d;
+    }
+    return result;
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static double ScanAvx512(const t_vertex_id* columns, const double* values,
+        const double* row_sums, double row_sum, double* delta_q, size_t n) {
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d a = _mm512_set1_pd(row_sum);
+    __m512d max = _mm512_set1_pd(-std::numeric_limits<double>::infinity());
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+#ifdef RGMC_64BIT_VERTEX_IDS
+        __m512i index = _mm512_loadu_si512((const void*) (columns + i));
+        __m512d sums = _mm512_mask_i64gather_pd(_mm512_setzero_pd(),
+                0xFF, index, row_sums, 8);
+#else
+        __m256i index = _mm256_loadu_si256((const __m256i*) (columns + i));
+        __m512d sums = _mm512_mask_i32gather_pd(_mm512_setzero_pd(),
+                0xFF, index, row_sums, 8);
+#endif
+        __m512d d = _mm512_mul_pd(two,
+                _mm512_sub_pd(_mm512_loadu_pd(values + i),
+                _mm512_mul_pd(a, sums)));
+        _mm512_storeu_pd(delta_q + i, d);
+        max = _mm512_mask_max_pd(max, 0xFF, max, d);
+    }
+
+    double lanes[8];
+    _mm512_storeu_pd(lanes, max);
+    double result = lanes[0];
+    for (int j = 1; j < 8; j++)
+        if (lanes[j] > result) result = lanes[j];
+
+    for (; i < n; i++) {
+        double d = 2 * (values[i] - row_sum * row_sums[columns[i]]);
+        delta_q[i] = d;
+        if (d > result) result = d;
+    }
+    return result;
+}
+
+#endif
+
+static t_delta_q_kernel SelectKernel() {
+#ifdef RGMC_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return ScanAvx512;
+    if (__builtin_cpu_supports("avx2")) return ScanAvx2;
+#endif
+    return ScanScalar;
+}
+
+DeltaQScanner::DeltaQScanner() {
+}
+
+DeltaQScanner::~DeltaQScanner() {
+}
+
+/*
+ * Scans all entries of a row except the diagonal. If the best delta Q of the
+ * row beats max_delta_q, best_joins is cleared first. All entries with exactly
+ * this delta Q are appended to best_joins in the iteration order of the row,
+ * the larger cluster comes first in each join.
+ */
+void DeltaQScanner::ScanRow(SparseClusteringMatrix* cluster_matrix,
+        t_vertex_id row, double* max_delta_q,
+        std::vector<t_vertex_pair>* best_joins) {
+    static const t_delta_q_kernel kernel = SelectKernel();
+
+    t_row_value_map* sample_row = cluster_matrix->GetRow(row);
+    if (columns_.size() < sample_row->size()) {
+        columns_.resize(sample_row->size());
+        values_.resize(sample_row->size());
+        delta_q_.resize(sample_row->size());
+    }
+
+    size_t n = 0;
+    for (t_row_value_map::iterator entry = sample_row->begin();
+            entry != sample_row->end(); ++entry) {
+        if (entry->first == row) continue;
+        columns_[n] = entry->first;
+        values_[n] = entry->second;
+        n++;
+    }
+    if (n == 0) return;
+
+    double row_max = kernel(&columns_[0], &values_[0],
+            cluster_matrix->GetRowSums(), cluster_matrix->GetRowSum(row),
+            &delta_q_[0], n);
+    if (row_max < *max_delta_q) return;
+
+    // Found a better delta_q => delete previous results
+    if (row_max > *max_delta_q) {
+        best_joins->clear();
+        *max_delta_q = row_max;
+    }
+
+    t_vertex_id row_entries = cluster_matrix->GetRowEntries(row);
+    for (size_t i = 0; i < n; i++) {
+        if (delta_q_[i] != row_max) continue;
+        t_vertex_id column = columns_[i];
+        if (row_entries >= cluster_matrix->GetRowEntries(column))
+            best_joins->push_back(std::make_pair(row, column));
+        else
+            best_joins->push_back(std::make_pair(column, row));
+    }
+}
@@ -0,0 +1,47 @@
+//============================================================================
+// Name        : DeltaQScan.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : finds the joins with the highest delta Q in a row of the
+//               cluster matrix. The row is copied into plain arrays and
+//               scanned by a vectorised kernel that is chosen at runtime
+//               (AVX-512, AVX2 or scalar)
+//============================================================================
+
+
+#ifndef DELTAQSCAN_H_
+#define DELTAQSCAN_H_
+
+#include <vector>
+#include <cstddef>
+
+#include "indextypes.h"
+
+class SparseClusteringMatrix;
+
+/*
+ * computes delta_q[i] = 2 * (values[i] - row_sum * row_sums[columns[i]])
+ * for i < n and returns the maximum of delta_q (-infinity for n = 0)
+ */
+typedef double (*t_delta_q_kernel)(const t_vertex_id* columns,
+        const double* values, const double* row_sums, double row_sum,
+        double* delta_q, size_t n);
+
+class DeltaQScanner {
+public:
+    DeltaQScanner();
+    virtual ~DeltaQScanner();
+
+    void ScanRow(SparseClusteringMatrix* cluster_matrix, t_vertex_id row,
+        double* max_delta_q, std::vector<t_vertex_pair>* best_joins);
+
+    static const char* GetKernelName();
+
+private:
+    std::vector<t_vertex_id> columns_;
+    std::vector<double> values_;
+    std::vector<double> delta_q_;
+};
+
+#endif /* DELTAQSCAN_H_ */
@@ -0,0 +1,264 @@
+//============================================================================
+// Name        : Dendrogram.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : the complete join sequence of an RG run with the modularity
+//               after every join, stored in a binary file and cut at any
+//               step or number of clusters
+//============================================================================
+
+
+#include "dendrogram.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <iostream>
+#include <fstream>
+
+#include <boost/foreach.hpp>
+
+#include "graph.h"
+#include "partition.h"
+
+/*
+ * File layout (host byte order):
+ *   char[8]      "RGMCDEND"
+ *   uint32       format version (1)
+ *   uint32       sizeof(t_vertex_id)
+ *   t_vertex_id  number of vertices n, number of joins s
+ *   double       Q of the start clusters
+ *   t_vertex_id  n rows of the start clusters of the vertices in file order
+ *   t_vertex_id  s pairs of rows, the second row is joined into the first
+ *   double       s values of Q after each join
+ */
+static const char kMagic[8] = {'R', 'G', 'M', 'C', 'D', 'E', 'N', 'D'};
+static const uint32_t kVersion = 1;
+
+Dendrogram::Dendrogram() {
+    start_cluster_count_ = 0;
+    start_q_ = 0;
+}
+
+/*
+ * takes the first step_count joins of a join phase that started from the
+ * given partition (singletons if NULL), join_q holds Q after each join and
+ * start_q the Q before the first one
+ */
+Dendrogram::Dendrogram(Graph* graph, Partition* start_partition,
+        std::vector<t_vertex_pair>* joins, std::vector<double>* join_q,
+        t_vertex_id step_count, double start_q) {
+    start_rows_.resize(graph->get_vertex_count());
+    if (start_partition == NULL) {
+        for (t_vertex_id i = 0; i < graph->get_vertex_count(); i++)
+            start_rows_[graph->GetOriginalId(i)] = i;
+        start_cluster_count_ = graph->get_vertex_count();
+    } else {
+        // as in the cluster matrix, a cluster is the row of its first vertex
+        start_cluster_count_ = 0;
+        for (size_t i = 0; i < start_partition->get_partition_vector()->size();
+                i++) {
+            t_id_list* cluster = start_partition->get_partition_vector()->at(i);
+            if (cluster->empty()) continue;
+
+            t_vertex_id row = cluster->front();
+            BOOST_FOREACH(t_vertex_id vertex_id, *cluster)
+                start_rows_[graph->GetOriginalId(vertex_id)] = row;
+            start_cluster_count_++;
+        }
+    }
+
+    joins_.assign(joins->begin(), joins->begin() + step_count);
+    join_q_.assign(join_q->begin(), join_q->begin() + step_count);
+    start_q_ = start_q;
+}
+
+Dendrogram::~Dendrogram() {
+}
+
+/*
+ * reads a file written by Store, returns NULL if it can not be read or is
+ * inconsistent
+ */
+Dendrogram* Dendrogram::Load(std::string filename) {
+    std::ifstream in(filename.data(), std::ios_base::in | std::ios_base::binary);
+    if (!in) {
+        std::cerr << "Cannot open dendrogram file.\n";
+        return NULL;
+    }
+
+    char magic[8];
+    uint32_t version, id_size;
+    t_vertex_id vertex_count, step_count;
+    double start_q;
+    in.read(magic, sizeof(magic));
+    in.read((char*) &version, sizeof(version));
+    in.read((char*) &id_size, sizeof(id_size));
+    in.read((char*) &vertex_count, sizeof(vertex_count));
+    in.read((char*) &step_count, sizeof(step_count));
+    in.read((char*) &start_q, sizeof(start_q));
+    if (!in || memcmp(magic, kMagic, sizeof(magic)) != 0 ||
+            version != kVersion || id_size != sizeof(t_vertex_id) ||
+            vertex_count < 1 || step_count < 0 || step_count >= vertex_count) {
+        std::cerr << "Invalid dendrogram file.\n";
+        return NULL;
+    }
+
+    Dendrogram* dendrogram = new Dendrogram();
+    dendrogram->start_q_ = start_q;
+    dendrogram->start_rows_.resize(vertex_count);
+    dendrogram->joins_.resize(step_count);
+    dendrogram->join_q_.resize(step_count);
+    in.read((char*) &dendrogram->start_rows_[0],
+            vertex_count * sizeof(t_vertex_id));
+    for (t_vertex_id i = 0; i < step_count; i++) {
+        in.read((char*) &dendrogram->joins_[i].first, sizeof(t_vertex_id));
+        in.read((char*) &dendrogram->joins_[i].second, sizeof(t_vertex_id));
+    }
+    if (step_count > 0)
+        in.read((char*) &dendrogram->join_q_[0], step_count * sizeof(double));
+
+    // every join must merge two distinct rows that still exist
+    std::vector<bool> active(vertex_count, false);
+    bool valid = (bool) in;
+    for (t_vertex_id i = 0; valid && i < vertex_count; i++) {
+        t_vertex_id row = dendrogram->start_rows_[i];
+        valid = row >= 0 && row < vertex_count;
+        if (valid && !active[row]) {
+            active[row] = true;
+            dendrogram->start_cluster_count_++;
+        }
+    }
+    for (t_vertex_id i = 0; valid && i < step_count; i++) {
+        t_vertex_pair& join = dendrogram->joins_[i];
+        valid = join.first >= 0 && join.first < vertex_count &&
+                join.second >= 0 && join.second < vertex_count &&
+                join.first != join.second &&
+                active[join.first] && active[join.second];
+        if (valid) active[join.second] = false;
+    }
+    if (!valid) {
+        std::cerr << "Invalid dendrogram file.\n";
+        delete dendrogram;
+        return NULL;
+    }
+    return dendrogram;
+}
+
+bool Dendrogram::Store(std::string filename) {
+    std::ofstream out(filename.data(),
+            std::ios_base::out | std::ios_base::binary);
+    if (!out) {
+        std::cerr << "Cannot open dendrogram file.\n";
+        return false;
+    }
+
+    uint32_t version = kVersion;
+    uint32_t id_size = sizeof(t_vertex_id);
+    t_vertex_id vertex_count = get_vertex_count();
+    t_vertex_id step_count = get_step_count();
+    out.write(kMagic, sizeof(kMagic));
+    out.write((const char*) &version, sizeof(version));
+    out.write((const char*) &id_size, sizeof(id_size));
+    out.write((const char*) &vertex_count, sizeof(vertex_count));
+    out.write((const char*) &step_count, sizeof(step_count));
+    out.write((const char*) &start_q_, sizeof(start_q_));
+    out.write((const char*) &start_rows_[0],
+            vertex_count * sizeof(t_vertex_id));
+    for (t_vertex_id i = 0; i < step_count; i++) {
+        out.write((const char*) &joins_[i].first, sizeof(t_vertex_id));
+        out.write((const char*) &joins_[i].second, sizeof(t_vertex_id));
+    }
+    if (step_count > 0)
+        out.write((const char*) &join_q_[0], step_count * sizeof(double));
+
+    out.close();
+    if (!out) {
+        std::cerr << "Cannot write dendrogram file.\n";
+        return false;
+    }
+    return true;
+}
+
+t_vertex_id Dendrogram::get_vertex_count() {
+    return start_rows_.size();
+}
+
+t_vertex_id Dendrogram::get_step_count() {
+    return joins_.size();
+}
+
+/*
+ * number of clusters after the first steps joins
+ */
+t_vertex_id Dendrogram::GetClusterCount(t_vertex_id steps) {
+    return start_cluster_count_ - steps;
+}
+
+/*
+ * number of joins after which Q is highest, the earliest if several are
+ * equal
+ */
+t_vertex_id Dendrogram::GetBestStepCount() {
+    t_vertex_id best_steps = 0;
+    for (t_vertex_id i = 0; i < get_step_count(); i++)
+        if (join_q_[i] > GetModularity(best_steps))
+            best_steps = i + 1;
+    return best_steps;
+}
+
+/*
+ * Q after the first steps joins (before refinement)
+ */
+double Dendrogram::GetModularity(t_vertex_id steps) {
+    return steps == 0 ? start_q_ : join_q_[steps - 1];
+}
+
+/*
+ * number of joins that leaves the given number of clusters, or the nearest
+ * one the join sequence reaches
+ */
+t_vertex_id Dendrogram::GetStepsForClusterCount(t_vertex_id cluster_count) {
+    t_vertex_id steps = start_cluster_count_ - cluster_count;
+    if (steps < 0) return 0;
+    return steps < get_step_count() ? steps : get_step_count();
+}
+
+/*
+ * returns the 1-based cluster id of every vertex (in the order of the graph
+ * file) after the first steps joins. Linear in the number of vertices: every
+ * join links the removed row to the remaining one, the cluster of a vertex is
+ * the root of its start row.
+ */
+std::vector<t_vertex_id>* Dendrogram::CutAtSteps(t_vertex_id steps) {
+    if (steps < 0) steps = 0;
+    if (steps > get_step_count()) steps = get_step_count();
+
+    t_vertex_id vertex_count = get_vertex_count();
+    std::vector<t_vertex_id> parent(vertex_count);
+    for (t_vertex_id i = 0; i < vertex_count; i++)
+        parent[i] = i;
+    for (t_vertex_id i = 0; i < steps; i++)
+        parent[joins_[i].second] = joins_[i].first;
+
+    std::vector<t_vertex_id> cluster_ids(vertex_count, 0);
+    std::vector<t_vertex_id>* assignments =
+            new std::vector<t_vertex_id>(vertex_count);
+    t_vertex_id cluster_count = 0;
+    for (t_vertex_id i = 0; i < vertex_count; i++) {
+        t_vertex_id root = start_rows_[i];
+        while (parent[root] != root) {
+            parent[root] = parent[parent[root]]; // path halving
+            root = parent[root];
+        }
+        if (cluster_ids[root] == 0)
+            cluster_ids[root] = ++cluster_count;
+        (*assignments)[i] = cluster_ids[root];
+    }
+    return assignments;
+}
+
+std::vector<t_vertex_id>* Dendrogram::CutAtClusterCount(
+        t_vertex_id cluster_count) {
+    return CutAtSteps(GetStepsForClusterCount(cluster_count));
+}
@@ -0,0 +1,54 @@
+//============================================================================
+// Name        : Dendrogram.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : the complete join sequence of an RG run with the modularity
+//               after every join, stored in a binary file and cut at any
+//               step or number of clusters
+//============================================================================
+
+
+#ifndef DENDROGRAM_H_
+#define DENDROGRAM_H_
+
+#include <string>
+#include <vector>
+
+#include "indextypes.h"
+
+class Graph;
+class Partition;
+
+class Dendrogram {
+public:
+    Dendrogram(Graph* graph, Partition* start_partition,
+        std::vector<t_vertex_pair>* joins, std::vector<double>* join_q,
+        t_vertex_id step_count, double start_q);
+    virtual ~Dendrogram();
+
+    static Dendrogram* Load(std::string filename);
+    bool Store(std::string filename);
+
+    t_vertex_id get_vertex_count();
+    t_vertex_id get_step_count();
+    t_vertex_id GetClusterCount(t_vertex_id steps);
+    t_vertex_id GetBestStepCount();
+    t_vertex_id GetStepsForClusterCount(t_vertex_id cluster_count);
+    double GetModularity(t_vertex_id steps);
+
+    std::vector<t_vertex_id>* CutAtSteps(t_vertex_id steps);
+    std::vector<t_vertex_id>* CutAtClusterCount(t_vertex_id cluster_count);
+
+private:
+    Dendrogram();
+
+    std::vector<t_vertex_id> start_rows_; // vertex (file order) -> row of
+                                          // its start cluster
+    t_vertex_id start_cluster_count_;
+    std::vector<t_vertex_pair> joins_;    // row second is joined into first
+    std::vector<double> join_q_;          // Q after each join
+    double start_q_;                      // Q of the start clusters
+};
+
+#endif /* DENDROGRAM_H_ */
@@ -10,6 +10,7 @@
 #include "graph.h"
 
 #include <fstream>
+#include <algorithm>
 
 #include <boost/tokenizer.hpp>
 #include <boost/foreach.hpp>
@@ -21,34 +22,230 @@ using namespace boost;
 
 
 
-Graph::Graph(std::string filename) {
+/*
+ * loads a graph from file, with compress the neighbor lists are stored
+ * compressed (METIS files already while reading)
+ */
+Graph::Graph(std::string filename, bool compress) {
     id_mapper_ = NULL;
-    LoadFromFile(filename);
+    compressed_ = false;
+    LoadFromFile(filename, compress);
+    if (compress) Compress();
 }
 
 Graph::Graph(Graph* ingraph, t_id_list* vertexlist) {
     id_mapper_ = NULL;
+    compressed_ = false;
     LoadSubgraph(ingraph, vertexlist);
 }
 
-Graph::Graph(int vertexcount, list<pair<int, int> >* elist) {
+Graph::Graph(t_vertex_id vertexcount, list<t_vertex_pair>* elist) {
     id_mapper_ = NULL;
+    compressed_ = false;
     LoadFromEdgelist(vertexcount, elist);
 }
 
-int Graph::get_vertex_count() {
+t_vertex_id Graph::get_vertex_count() {
     return vertex_count_;
 }
 
-int Graph::get_edge_count() {
+t_edge_count Graph::get_edge_count() {
     return edge_count_;
 }
 
-vector<int>* Graph::GetNeighbors(int &vertex_id) {
-    return neighbors_.at(vertex_id);
+/*
+ * Compressed neighbor lists: the first neighbor is stored as the difference
+ * to the vertex, every further neighbor as the difference to the previous
+ * one. The differences are zigzag coded (small negative values become small
+ * positive ones) and written as varints of 7 bits per byte, the lowest bits
+ * first. The order of the lists is kept, so the clustering does not change;
+ * lists sorted by the file or by Relabel have small differences and mostly
+ * take one or two bytes per neighbor instead of four.
+ */
+static inline uint64_t ZigZag(int64_t delta) {
+    return ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63);
+}
+
+static inline int64_t UnZigZag(uint64_t value) {
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static void AppendList(vector<unsigned char>* bytes, t_vertex_id vertex_id,
+        vector<t_vertex_id>* neighbors) {
+    t_vertex_id previous = vertex_id;
+    for (size_t i = 0; i < neighbors->size(); i++) {
+        uint64_t value = ZigZag((int64_t) (*neighbors)[i] - previous);
+        while (value >= 0x80) {
+            bytes->push_back((unsigned char) (value | 0x80));
+            value >>= 7;
+        }
+        bytes->push_back((unsigned char) value);
+        previous = (*neighbors)[i];
+    }
+}
+
+static void DecodeList(const unsigned char* bytes, t_vertex_id vertex_id,
+        t_vertex_id degree, t_vertex_id* neighbors) {
+    t_vertex_id previous = vertex_id;
+    for (t_vertex_id i = 0; i < degree; i++) {
+        uint64_t value = *bytes & 0x7f;
+        int shift = 7;
+        while (*bytes++ & 0x80) {
+            value |= (uint64_t) (*bytes & 0x7f) << shift;
+            shift += 7;
+        }
+        previous = (t_vertex_id) (previous + UnZigZag(value));
+        neighbors[i] = previous;
+    }
+}
+
+t_vertex_id Graph::GetDegree(t_vertex_id vertex_id) {
+    if (compressed_) return degrees_[vertex_id];
+    return neighbors_.at(vertex_id)->size();
+}
+
+/*
+ * Returns the neighbors of the vertex. A compressed list is decoded into
+ * buffer, otherwise the stored list is returned and buffer stays unused.
+ * Threads decoding at the same time need buffers of their own.
+ */
+vector<t_vertex_id>* Graph::GetNeighbors(t_vertex_id vertex_id,
+        vector<t_vertex_id>* buffer) {
+    if (!compressed_) return neighbors_.at(vertex_id);
+
+    t_vertex_id degree = degrees_[vertex_id];
+    buffer->resize(degree);
+    if (degree > 0)
+        DecodeList(&adjacency_[offsets_[vertex_id]], vertex_id, degree,
+                &(*buffer)[0]);
+    return buffer;
+}
+
+void Graph::AppendCompressed(t_vertex_id vertex_id,
+        vector<t_vertex_id>* neighbors) {
+    AppendList(&adjacency_, vertex_id, neighbors);
+    offsets_.push_back(adjacency_.size());
+    degrees_.push_back(neighbors->size());
+}
+
+/*
+ * replaces the neighbor lists by their compressed form, every list is freed
+ * right after it is coded
+ */
+void Graph::Compress() {
+    if (compressed_) return;
+
+    adjacency_.clear();
+    offsets_.assign(1, 0);
+    offsets_.reserve(vertex_count_ + 1);
+    degrees_.clear();
+    degrees_.reserve(vertex_count_);
+    for (t_vertex_id i = 0; i < vertex_count_; i++) {
+        AppendCompressed(i, neighbors_[i]);
+        delete neighbors_[i];
+    }
+    vector<vector<t_vertex_id>* >().swap(neighbors_);
+    vector<unsigned char>(adjacency_).swap(adjacency_); // drop spare capacity
+    compressed_ = true;
+}
+
+/*
+ * restores the neighbor lists, needed before the graph is changed
+ */
+void Graph::Decompress() {
+    if (!compressed_) return;
+
+    neighbors_.resize(vertex_count_);
+    for (t_vertex_id i = 0; i < vertex_count_; i++) {
+        neighbors_[i] = new vector<t_vertex_id>(degrees_[i]);
+        if (degrees_[i] > 0)
+            DecodeList(&adjacency_[offsets_[i]], i, degrees_[i],
+                    &(*neighbors_[i])[0]);
+    }
+    vector<unsigned char>().swap(adjacency_);
+    vector<t_edge_count>().swap(offsets_);
+    vector<t_vertex_id>().swap(degrees_);
+    compressed_ = false;
+}
+
+bool Graph::IsCompressed() {
+    return compressed_;
+}
+
+/*
+ * bytes used for the neighbor lists
+ */
+size_t Graph::GetAdjacencyBytes() {
+    if (compressed_)
+        return adjacency_.capacity() + offsets_.capacity() * sizeof(t_edge_count) +
+                degrees_.capacity() * sizeof(t_vertex_id);
+
+    size_t bytes = neighbors_.capacity() * sizeof(vector<t_vertex_id>*);
+    for (size_t i = 0; i < neighbors_.size(); i++)
+        bytes += sizeof(vector<t_vertex_id>) +
+                neighbors_[i]->capacity() * sizeof(t_vertex_id);
+    return bytes;
+}
+
+/*
+ * bytes used for the neighbor lists and the id maps
+ */
+size_t Graph::GetMemoryBytes() {
+    size_t bytes = GetAdjacencyBytes() + (original_ids_.capacity() +
+            internal_ids_.capacity()) * sizeof(t_vertex_id);
+    if (id_mapper_ != NULL)
+        bytes += (id_mapper_->bucket_count() + 1) * sizeof(void*) +
+                id_mapper_->size() * 32;
+    return bytes;
+}
+
+/*
+ * bytes of the neighbor lists of a graph, compressed lists take about 1.5
+ * bytes per entry on graphs with locality
+ */
+size_t Graph::EstimateBytes(t_vertex_id vertex_count, t_edge_count edge_count,
+        bool compressed) {
+    if (compressed)
+        return (size_t) vertex_count * (sizeof(t_edge_count) +
+                sizeof(t_vertex_id)) + (size_t) edge_count * 3;
+    return (size_t) vertex_count * (sizeof(vector<t_vertex_id>*) +
+            sizeof(vector<t_vertex_id>)) +
+            (size_t) edge_count * 2 * sizeof(t_vertex_id);
+}
+
+// 64 bit FNV-1a
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t length) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+ * hash of the vertex and edge count and of all neighbor lists in the current
+ * vertex order, equal for equal graphs on all platforms with the same sizes
+ * of vertex ids and edge counts
+ */
+uint64_t Graph::GetContentHash() {
+    uint64_t hash = 14695981039346656037ULL;
+    hash = HashBytes(hash, &vertex_count_, sizeof(vertex_count_));
+    hash = HashBytes(hash, &edge_count_, sizeof(edge_count_));
+
+    vector<t_vertex_id> buffer;
+    for (t_vertex_id i = 0; i < vertex_count_; i++) {
+        vector<t_vertex_id>* neighbors = GetNeighbors(i, &buffer);
+        t_vertex_id degree = neighbors->size();
+        hash = HashBytes(hash, &degree, sizeof(degree));
+        if (degree > 0)
+            hash = HashBytes(hash, &neighbors->at(0),
+                    degree * sizeof(t_vertex_id));
+    }
+    return hash;
 }
 
-unordered_map<int, int>* Graph::get_id_mapper() {
+unordered_map<t_vertex_id, t_vertex_id>* Graph::get_id_mapper() {
     return id_mapper_;
 }
 
@@ -57,7 +254,7 @@ unordered_map<int, int>* Graph::get_id_mapper() {
  * file must be in Pajek .net or METIS .graph file format with appropriate
  * file extension, reads only undirected, unweighted files
  */
-void Graph::LoadFromFile(std::string filename) {
+void Graph::LoadFromFile(std::string filename, bool compress) {
     vertex_count_ = 0;
     edge_count_ = 0;
 
@@ -73,26 +270,45 @@ void Graph::LoadFromFile(std::string filename) {
 
         char *tok;
         tok = strtok(line, " ");
-        vertex_count_ = atoi(tok);
+        vertex_count_ = strtoll(tok, NULL, 10);
+
+        // a line holds the complete list of a vertex, it can be compressed
+        // right away
+        vector<t_vertex_id> line_neighbors;
+        if (compress) {
+            offsets_.assign(1, 0);
+            offsets_.reserve(vertex_count_ + 1);
+            degrees_.reserve(vertex_count_);
+        }
 
-        for (int i = 0; i < vertex_count_; i++) {
+        for (t_vertex_id i = 0; i < vertex_count_; i++) {
             std::string line;
-            int from = i;
-            neighbors_.push_back(new vector<int>());
+            t_vertex_id from = i;
+            vector<t_vertex_id>* neighbors = &line_neighbors;
+            if (!compress) {
+                neighbors = new vector<t_vertex_id>();
+                neighbors_.push_back(neighbors);
+            }
+            neighbors->clear();
             getline(infile, line);
 
             char_separator<char> sep(" ");
             tokenizer<char_separator<char> > tokens(line, sep);
 
             BOOST_FOREACH(std::string tok, tokens) {
-                int to = atoi(tok.data()) - 1;
+                t_vertex_id to = strtoll(tok.data(), NULL, 10) - 1;
                 if (from != to) {
-                    neighbors_.at(from)->push_back(to);
+                    neighbors->push_back(to);
                     edge_count_++;
                 }
             }
+            if (compress) AppendCompressed(from, neighbors);
         }
         edge_count_ = edge_count_ / 2;
+        if (compress) {
+            vector<unsigned char>(adjacency_).swap(adjacency_);
+            compressed_ = true;
+        }
     }
     else if (filename.rfind(".net") != std::string::npos) { // read Pajek .net file
         infile.getline(line, 255);
@@ -100,12 +316,12 @@ void Graph::LoadFromFile(std::string filename) {
         tok = strtok(line, " "); // Skip *Vertices
         tok = strtok(NULL, " ");
 
-        vertex_count_ = atoi(tok); // read vertex count
+        vertex_count_ = strtoll(tok, NULL, 10); // read vertex count
 
         // read vertex degrees
-        for (int i = 0; i < vertex_count_; i++) { // read vertex degree
+        for (t_vertex_id i = 0; i < vertex_count_; i++) { // read vertex degree
             infile.getline(line, 255);
-            neighbors_.push_back(new vector<int>());
+            neighbors_.push_back(new vector<t_vertex_id>());
         }
 
         infile.getline(line, 255); // skip "*Edges"
@@ -115,10 +331,10 @@ void Graph::LoadFromFile(std::string filename) {
             char *tok;
 
             tok = strtok(line, " ");
-            int from = atol(tok) - 1;
+            t_vertex_id from = strtoll(tok, NULL, 10) - 1;
 
             tok = strtok(NULL, " ");
-            int to = atol(tok) - 1;
+            t_vertex_id to = strtoll(tok, NULL, 10) - 1;
 
             tok = strtok(NULL, " ");
 
@@ -140,14 +356,14 @@ void Graph::LoadSubgraph(Graph* ingraph, t_id_list* vertexlist) {
     vertex_count_ = vertexlist->size();
     edge_count_ = 0;
 
-    typedef unordered_map<int, int> t_id_id_map;
+    typedef unordered_map<t_vertex_id, t_vertex_id> t_id_id_map;
     t_id_id_map* reverse_mapping = new t_id_id_map(); // map original_id from source graph -> new id in this graph
     id_mapper_ = new t_id_id_map(); // maps new id in this graph -> original_id from source graph
 
     // read vertex degrees
-    int i = 0;
-    BOOST_FOREACH(int original_id, *vertexlist) {
-        neighbors_.push_back(new vector<int>());
+    t_vertex_id i = 0;
+    BOOST_FOREACH(t_vertex_id original_id, *vertexlist) {
+        neighbors_.push_back(new vector<t_vertex_id>());
 
         t_id_id_map::value_type* rentry = new t_id_id_map::value_type(original_id, i);
         reverse_mapping->insert(*rentry);
@@ -160,60 +376,189 @@ void Graph::LoadSubgraph(Graph* ingraph, t_id_list* vertexlist) {
     }
 
     // read edges
-    BOOST_FOREACH(int vertex_id, *vertexlist) {
-        vector<int>* t_neighbors = ingraph->GetNeighbors(vertex_id);
-        int from = reverse_mapping->at(vertex_id);
+    vector<t_vertex_id> buffer;
+    BOOST_FOREACH(t_vertex_id vertex_id, *vertexlist) {
+        vector<t_vertex_id>* t_neighbors = ingraph->GetNeighbors(vertex_id, &buffer);
+        t_vertex_id from = reverse_mapping->at(vertex_id);
 
         for (size_t j = 0; j < t_neighbors->size(); j++) {
             // if edge goes to vertex outside of sub-group of vertices (vertexlist) ignore this edge
             if (reverse_mapping->find(t_neighbors->at(j)) == reverse_mapping->end())
                 continue;
 
-            int to = reverse_mapping->at(t_neighbors->at(j));
+            t_vertex_id to = reverse_mapping->at(t_neighbors->at(j));
 
+            // the reverse direction is added when visiting vertex to
             if (from != to) { // do not add loops
                 neighbors_.at(from)->push_back(to);
-                neighbors_.at(to)->push_back(from);
                 edge_count_++;
             }
         }
     }
+    edge_count_ = edge_count_ / 2;
     
     delete reverse_mapping;
 }
 
-void Graph::LoadFromEdgelist(int vertexcount, list<pair<int, int> >* elist) {
+void Graph::LoadFromEdgelist(t_vertex_id vertexcount, list<t_vertex_pair>* elist) {
     this->vertex_count_ = vertexcount;
-    for (int i = 0; i < vertex_count_; i++)
-        neighbors_.push_back(new vector<int>());
+    for (t_vertex_id i = 0; i < vertex_count_; i++)
+        neighbors_.push_back(new vector<t_vertex_id>());
 
     edge_count_ = 0;
-    typedef pair<int,int> t_intpair;
-    BOOST_FOREACH(t_intpair edge, *elist) {
+    BOOST_FOREACH(t_vertex_pair edge, *elist) {
         this->neighbors_.at(edge.first)->push_back(edge.second);
         this->neighbors_.at(edge.second)->push_back(edge.first);
         edge_count_++;
     }
 }
 
-void recursive_visit(Graph* graph, t_id_list* cluster, int i, std::vector<bool>* visited) {
+/*
+ * adds an undirected edge, vertices with ids beyond the current vertex count
+ * are added to the graph. After Relabel the new vertices keep their id as id
+ * in the file. Returns false for negative ids, loops and existing edges.
+ */
+bool Graph::AddEdge(t_vertex_id from, t_vertex_id to) {
+    if (from < 0 || to < 0 || from == to)
+        return false;
+    Decompress();
+
+    while (vertex_count_ <= from || vertex_count_ <= to) {
+        neighbors_.push_back(new vector<t_vertex_id>());
+        if (!original_ids_.empty()) {
+            original_ids_.push_back(vertex_count_);
+            internal_ids_.push_back(vertex_count_);
+        }
+        vertex_count_++;
+    }
+
+    // scan the shorter list for an existing edge
+    vector<t_vertex_id>* shorter = neighbors_[from];
+    t_vertex_id other = to;
+    if (neighbors_[to]->size() < shorter->size()) {
+        shorter = neighbors_[to];
+        other = from;
+    }
+    if (std::find(shorter->begin(), shorter->end(), other) != shorter->end())
+        return false;
+
+    neighbors_[from]->push_back(to);
+    neighbors_[to]->push_back(from);
+    edge_count_++;
+    return true;
+}
+
+static bool RemoveNeighbor(vector<t_vertex_id>* neighbors,
+        t_vertex_id vertex_id) {
+    vector<t_vertex_id>::iterator iter =
+            std::find(neighbors->begin(), neighbors->end(), vertex_id);
+    if (iter == neighbors->end())
+        return false;
+
+    // order of neighbors is not significant, fill the gap with the last entry
+    *iter = neighbors->back();
+    neighbors->pop_back();
+    return true;
+}
+
+/*
+ * removes an undirected edge, returns false if the edge does not exist
+ */
+bool Graph::RemoveEdge(t_vertex_id from, t_vertex_id to) {
+    if (from < 0 || to < 0 || from >= vertex_count_ || to >= vertex_count_)
+        return false;
+    Decompress();
+
+    if (!RemoveNeighbor(neighbors_[from], to))
+        return false;
+    RemoveNeighbor(neighbors_[to], from);
+    edge_count_--;
+    return true;
+}
+
+/*
+ * gives vertex order[i] the new id i and sorts all neighbor lists. The ids
+ * the vertices had in the file stay available through GetOriginalId.
+ */
+void Graph::Relabel(vector<t_vertex_id>* order) {
+    vector<t_vertex_id> new_ids(vertex_count_);
+    for (t_vertex_id i = 0; i < vertex_count_; i++)
+        new_ids[order->at(i)] = i;
+
+    vector<t_vertex_id> original_ids(vertex_count_);
+    if (compressed_) {
+        // the lists are coded again in the new order
+        vector<unsigned char> adjacency;
+        vector<t_edge_count> offsets;
+        vector<t_vertex_id> degrees;
+        adjacency.swap(adjacency_);
+        offsets.swap(offsets_);
+        degrees.swap(degrees_);
+        offsets_.assign(1, 0);
+        offsets_.reserve(vertex_count_ + 1);
+        degrees_.reserve(vertex_count_);
+
+        vector<t_vertex_id> neighbors;
+        for (t_vertex_id i = 0; i < vertex_count_; i++) {
+            t_vertex_id old_id = order->at(i);
+            neighbors.resize(degrees[old_id]);
+            if (degrees[old_id] > 0)
+                DecodeList(&adjacency[offsets[old_id]], old_id,
+                        degrees[old_id], &neighbors[0]);
+            for (size_t j = 0; j < neighbors.size(); j++)
+                neighbors[j] = new_ids[neighbors[j]];
+            std::sort(neighbors.begin(), neighbors.end());
+            AppendCompressed(i, &neighbors);
+            original_ids[i] = GetOriginalId(old_id);
+        }
+        vector<unsigned char>(adjacency_).swap(adjacency_);
+    } else {
+        vector<vector<t_vertex_id>* > neighbors(vertex_count_);
+        for (t_vertex_id i = 0; i < vertex_count_; i++) {
+            t_vertex_id old_id = order->at(i);
+            neighbors[i] = neighbors_[old_id];
+            for (size_t j = 0; j < neighbors[i]->size(); j++)
+                (*neighbors[i])[j] = new_ids[(*neighbors[i])[j]];
+            std::sort(neighbors[i]->begin(), neighbors[i]->end());
+            original_ids[i] = GetOriginalId(old_id);
+        }
+        neighbors_.swap(neighbors);
+    }
+    original_ids_.swap(original_ids);
+
+    internal_ids_.resize(vertex_count_);
+    for (t_vertex_id i = 0; i < vertex_count_; i++)
+        internal_ids_[original_ids_[i]] = i;
+}
+
+t_vertex_id Graph::GetOriginalId(t_vertex_id vertex_id) {
+    return original_ids_.empty() ? vertex_id : original_ids_[vertex_id];
+}
+
+t_vertex_id Graph::GetInternalId(t_vertex_id original_id) {
+    return internal_ids_.empty() ? original_id : internal_ids_[original_id];
+}
+
+void recursive_visit(Graph* graph, t_id_list* cluster, t_vertex_id i, std::vector<bool>* visited) {
     if (visited->at(i))
         return;
 
     cluster->push_back(i);
     visited->at(i) = true;
-    for (size_t n = 0; n < graph->GetNeighbors(i)->size(); n++)
-        if (!visited->at(graph->GetNeighbors(i)->at(n)))
-            recursive_visit(graph, cluster, graph->GetNeighbors(i)->at(n), visited);
+    vector<t_vertex_id> buffer;
+    vector<t_vertex_id>* neighbors = graph->GetNeighbors(i, &buffer);
+    for (size_t n = 0; n < neighbors->size(); n++)
+        if (!visited->at(neighbors->at(n)))
+            recursive_visit(graph, cluster, neighbors->at(n), visited);
 }
 
 Partition* Graph::GetConnectedComponents() {
     std::vector<bool>* visited = new std::vector<bool>(this->get_vertex_count(), false);
 
-    int cc_counter = 0;
+    t_vertex_id cc_counter = 0;
     Partition* sccs = new Partition();
 
-    for (int i = 0; i < this->get_vertex_count(); i++) {
+    for (t_vertex_id i = 0; i < this->get_vertex_count(); i++) {
         if (!visited->at(i)) {
             t_id_list* new_cluster = new t_id_list();
             recursive_visit(this, new_cluster, i, visited);
@@ -227,7 +572,7 @@ Partition* Graph::GetConnectedComponents() {
 }
 
 Graph::~Graph() {
-    for (int i = 0; i < vertex_count_; i++)
+    for (size_t i = 0; i < neighbors_.size(); i++)
         delete neighbors_[i];
 
     delete id_mapper_;
@@ -16,33 +16,60 @@
 
 #include <boost/unordered_map.hpp>
 
+#include "indextypes.h"
 #include "partition.h"
 
 using namespace std;
 
 class Graph {
 public:
-    Graph(std::string filename);
-    Graph(Graph* ingraph, list<int>* vertexlist);
-    Graph(int vertexcount, list<pair<int, int> >* elist);
+    Graph(std::string filename, bool compress = false);
+    Graph(Graph* ingraph, t_id_list* vertexlist);
+    Graph(t_vertex_id vertexcount, list<t_vertex_pair>* elist);
     ~Graph();
 
-    int get_vertex_count();
-    int get_edge_count();
-    boost::unordered_map<int, int>* get_id_mapper();
+    t_vertex_id get_vertex_count();
+    t_edge_count get_edge_count();
+    boost::unordered_map<t_vertex_id, t_vertex_id>* get_id_mapper();
     
-    vector<int>* GetNeighbors(int &vertex_id);
+    t_vertex_id GetDegree(t_vertex_id vertex_id);
+    vector<t_vertex_id>* GetNeighbors(t_vertex_id vertex_id,
+        vector<t_vertex_id>* buffer);
     Partition* GetConnectedComponents();
 
+    void Compress();
+    void Decompress();
+    bool IsCompressed();
+    size_t GetAdjacencyBytes();
+    size_t GetMemoryBytes();
+    static size_t EstimateBytes(t_vertex_id vertex_count,
+        t_edge_count edge_count, bool compressed);
+    uint64_t GetContentHash();
+
+    bool AddEdge(t_vertex_id from, t_vertex_id to);
+    bool RemoveEdge(t_vertex_id from, t_vertex_id to);
+
+    void Relabel(vector<t_vertex_id>* order);
+    t_vertex_id GetOriginalId(t_vertex_id vertex_id);
+    t_vertex_id GetInternalId(t_vertex_id original_id);
+
 private:
-    int vertex_count_;
-    int edge_count_;
-    vector<vector<int>* > neighbors_;
-    boost::unordered_map<int, int>* id_mapper_;
+    t_vertex_id vertex_count_;
+    t_edge_count edge_count_;
+    vector<vector<t_vertex_id>* > neighbors_;  // empty when compressed
+    bool compressed_;
+    vector<unsigned char> adjacency_;   // neighbor lists, varint coded deltas
+    vector<t_edge_count> offsets_;      // vertex -> start of its list
+    vector<t_vertex_id> degrees_;
+    boost::unordered_map<t_vertex_id, t_vertex_id>* id_mapper_;
+    vector<t_vertex_id> original_ids_;  // id -> id in the file after Relabel
+    vector<t_vertex_id> internal_ids_;  // id in the file -> id
     
-    void LoadFromFile(std::string filename);
-    void LoadSubgraph(Graph* ingraph, list<int>* vertexlist);
-    void LoadFromEdgelist(int vertexcount, list<pair<int, int> >* elist);
+    void LoadFromFile(std::string filename, bool compress);
+    void AppendCompressed(t_vertex_id vertex_id,
+        vector<t_vertex_id>* neighbors);
+    void LoadSubgraph(Graph* ingraph, t_id_list* vertexlist);
+    void LoadFromEdgelist(t_vertex_id vertexcount, list<t_vertex_pair>* elist);
 };
 
 #endif /* GRAPH_H_ */
@@ -0,0 +1,65 @@
+//============================================================================
+// Name        : GraphReduction.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : reductions of a graph that do not change the optimal
+//               clustering, given as a partition that the join phase starts
+//               from
+//============================================================================
+
+
+#include "graphreduction.h"
+
+#include <vector>
+
+#include "graph.h"
+#include "partition.h"
+
+/*
+ * Returns a partition in which every vertex of degree 1 shares the cluster
+ * of its neighbor, all other vertices are singletons. A vertex of degree 1
+ * is never a singleton in a clustering of maximum modularity, so the join
+ * phase can start from this partition with one row less per pendant vertex.
+ * Returns NULL if the graph has no pendant vertices.
+ *
+ * Only pendant vertices of the input are folded. Folding repeatedly would
+ * also collapse chains and trees hanging off the graph, which can be split
+ * in an optimal clustering.
+ */
+Partition* FoldPendantVertices(Graph* graph) {
+    t_vertex_id vertex_count = graph->get_vertex_count();
+    std::vector<t_vertex_id> cluster_of(vertex_count); // maps vertex -> representative
+    t_vertex_id folded_count = 0;
+
+    for (t_vertex_id i = 0; i < vertex_count; i++)
+        cluster_of[i] = i;
+
+    vector<t_vertex_id> buffer;
+    for (t_vertex_id i = 0; i < vertex_count; i++) {
+        if (graph->GetDegree(i) != 1) continue;
+
+        t_vertex_id neighbor = (*graph->GetNeighbors(i, &buffer))[0];
+        // both ends of an isolated edge are pendant, fold only once
+        if (graph->GetDegree(neighbor) == 1 && neighbor < i) continue;
+        cluster_of[i] = neighbor;
+        folded_count++;
+    }
+
+    if (folded_count == 0)
+        return NULL;
+
+    // the representative is the first vertex of its cluster, so the rows of
+    // the cluster matrix stay at the vertices that are not folded
+    Partition* partition = new Partition(vertex_count);
+    for (t_vertex_id i = 0; i < vertex_count; i++) {
+        if (cluster_of[i] == i)
+            partition->get_partition_vector()->at(i)->push_back(i);
+    }
+    for (t_vertex_id i = 0; i < vertex_count; i++) {
+        if (cluster_of[i] != i)
+            partition->get_partition_vector()->at(cluster_of[i])->push_back(i);
+    }
+    partition->RemoveEmptyEntries();
+    return partition;
+}
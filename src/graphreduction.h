@@ -0,0 +1,20 @@
+//============================================================================
+// Name        : GraphReduction.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : reductions of a graph that do not change the optimal
+//               clustering, given as a partition that the join phase starts
+//               from
+//============================================================================
+
+
+#ifndef GRAPHREDUCTION_H_
+#define GRAPHREDUCTION_H_
+
+class Graph;
+class Partition;
+
+Partition* FoldPendantVertices(Graph* graph);
+
+#endif /* GRAPHREDUCTION_H_ */
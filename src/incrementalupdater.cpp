@@ -0,0 +1,357 @@
+//============================================================================
+// Name        : IncrementalUpdater.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : adapts an existing clustering to a batch of edge insertions
+//               and deletions by re-optimizing only the affected vertices
+//============================================================================
+
+
+#include "incrementalupdater.h"
+
+#include <deque>
+
+#include <boost/foreach.hpp>
+
+#include "modoptimizer.h"
+#include "graph.h"
+#include "randomsource.h"
+#include "localmover.h"
+
+IncrementalUpdater::IncrementalUpdater(Graph* graph, Partition* clusters,
+        RandomSource* random) {
+    graph_ = graph;
+    random_ = random;
+    moved_vertex_count_ = 0;
+    rejoined_vertex_count_ = 0;
+
+    clustermap_.resize(graph_->get_vertex_count(), -1);
+    positions_.resize(graph_->get_vertex_count());
+
+    for (size_t i = 0; i < clusters->get_partition_vector()->size(); i++) {
+        t_id_list* cluster = clusters->get_partition_vector()->at(i);
+        if (cluster == NULL)
+            continue;
+
+        t_vertex_id cluster_id = members_.size();
+        t_id_list* new_cluster = new t_id_list();
+        members_.push_back(new_cluster);
+        clusterdegree_.push_back(0);
+
+        BOOST_FOREACH(t_vertex_id vertex_id, *cluster) {
+            positions_[vertex_id] =
+                    new_cluster->insert(new_cluster->end(), vertex_id);
+            clustermap_[vertex_id] = cluster_id;
+            clusterdegree_[cluster_id] += graph_->GetDegree(vertex_id);
+        }
+    }
+
+    // vertices missing in the partition become singletons
+    for (t_vertex_id i = 0; i < graph_->get_vertex_count(); i++) {
+        if (clustermap_[i] != -1)
+            continue;
+
+        t_id_list* new_cluster = new t_id_list();
+        positions_[i] = new_cluster->insert(new_cluster->end(), i);
+        clustermap_[i] = members_.size();
+        members_.push_back(new_cluster);
+        clusterdegree_.push_back(graph_->GetDegree(i));
+    }
+}
+
+IncrementalUpdater::~IncrementalUpdater() {
+    for (size_t i = 0; i < members_.size(); i++)
+        delete members_[i];
+}
+
+t_vertex_id IncrementalUpdater::get_moved_vertex_count() {
+    return moved_vertex_count_;
+}
+
+t_vertex_id IncrementalUpdater::get_rejoined_vertex_count() {
+    return rejoined_vertex_count_;
+}
+
+/*
+ * applies the batch of edge changes to the graph and re-optimizes the
+ * clustering. First, vertices are moved between clusters starting from the
+ * endpoints of the changed edges. Clusters touched by the batch whose
+ * contribution to modularity is still lower than before the batch are then
+ * re-clustered by RG with the given sample size.
+ */
+void IncrementalUpdater::Update(list<t_vertex_pair>* insertions,
+        list<t_vertex_pair>* deletions, int sample_size) {
+    vector<t_vertex_id> touched;
+    boost::unordered_set<t_vertex_id> touched_lookup;
+    list<t_vertex_pair>* batches[2] = {deletions, insertions};
+    for (int b = 0; b < 2; b++) {
+        if (batches[b] == NULL) continue;
+        BOOST_FOREACH(t_vertex_pair edge, *batches[b]) {
+            if (touched_lookup.insert(edge.first).second)
+                touched.push_back(edge.first);
+            if (touched_lookup.insert(edge.second).second)
+                touched.push_back(edge.second);
+        }
+    }
+
+    // internal degree and degree of affected clusters before the changes,
+    // normalized by the edge count before the changes
+    double two_m_before = 2.0 * graph_->get_edge_count();
+    vector<t_vertex_id> affected;
+    boost::unordered_map<t_vertex_id, t_vertex_pair> before;
+    BOOST_FOREACH(t_vertex_id vertex_id, touched) {
+        if (vertex_id < 0 || vertex_id >= (t_vertex_id) clustermap_.size())
+            continue;
+        t_vertex_id cluster_id = clustermap_[vertex_id];
+        if (before.find(cluster_id) == before.end()) {
+            before[cluster_id] = make_pair(GetInternalDegree(cluster_id),
+                    clusterdegree_[cluster_id]);
+            affected.push_back(cluster_id);
+        }
+    }
+
+    if (deletions != NULL) {
+        BOOST_FOREACH(t_vertex_pair edge, *deletions) {
+            if (graph_->RemoveEdge(edge.first, edge.second)) {
+                clusterdegree_[clustermap_[edge.first]]--;
+                clusterdegree_[clustermap_[edge.second]]--;
+            }
+        }
+    }
+    if (insertions != NULL) {
+        BOOST_FOREACH(t_vertex_pair edge, *insertions) {
+            if (graph_->AddEdge(edge.first, edge.second)) {
+                AddVertices();
+                clusterdegree_[clustermap_[edge.first]]++;
+                clusterdegree_[clustermap_[edge.second]]++;
+            }
+        }
+    }
+
+    vector<t_vertex_id> seeds;
+    BOOST_FOREACH(t_vertex_id vertex_id, touched) {
+        if (vertex_id >= 0 && vertex_id < graph_->get_vertex_count())
+            seeds.push_back(vertex_id);
+    }
+    Refine(&seeds);
+
+    // escalate where the contribution to modularity dropped
+    vector<t_vertex_id> degraded;
+    BOOST_FOREACH(t_vertex_id cluster_id, affected) {
+        double q_before = 0;
+        if (two_m_before > 0) {
+            double a = before[cluster_id].second / two_m_before;
+            q_before = before[cluster_id].first / two_m_before - a * a;
+        }
+        if (GetContribution(cluster_id) < q_before - 1e-12)
+            degraded.push_back(cluster_id);
+    }
+    if (!degraded.empty())
+        Rejoin(&degraded, sample_size);
+}
+
+/*
+ * returns the updated clustering, without empty clusters
+ */
+Partition* IncrementalUpdater::GetPartition() {
+    Partition* result = new Partition();
+    for (size_t i = 0; i < members_.size(); i++) {
+        if (!members_[i]->empty())
+            result->get_partition_vector()->push_back(new t_id_list(*members_[i]));
+    }
+    return result;
+}
+
+/*
+ * vertices added to the graph by edge insertions become singletons
+ */
+void IncrementalUpdater::AddVertices() {
+    while ((t_vertex_id) clustermap_.size() < graph_->get_vertex_count()) {
+        t_vertex_id vertex_id = clustermap_.size();
+        t_id_list* new_cluster = new t_id_list();
+        positions_.push_back(new_cluster->insert(new_cluster->end(), vertex_id));
+        clustermap_.push_back(members_.size());
+        members_.push_back(new_cluster);
+        clusterdegree_.push_back(0);
+    }
+}
+
+/*
+ * returns twice the number of edges within the cluster
+ */
+t_edge_count IncrementalUpdater::GetInternalDegree(t_vertex_id cluster_id) {
+    t_edge_count internal_degree = 0;
+    vector<t_vertex_id> buffer;
+    BOOST_FOREACH(t_vertex_id vertex_id, *members_[cluster_id]) {
+        vector<t_vertex_id>* neighbors = graph_->GetNeighbors(vertex_id, &buffer);
+        for (size_t j = 0; j < neighbors->size(); j++) {
+            if (clustermap_[neighbors->at(j)] == cluster_id)
+                internal_degree++;
+        }
+    }
+    return internal_degree;
+}
+
+/*
+ * returns e_ii - a_i^2 of the cluster
+ */
+double IncrementalUpdater::GetContribution(t_vertex_id cluster_id) {
+    double two_m = 2.0 * graph_->get_edge_count();
+    double a = clusterdegree_[cluster_id] / two_m;
+    return GetInternalDegree(cluster_id) / two_m - a * a;
+}
+
+void IncrementalUpdater::MoveVertex(t_vertex_id vertex_id,
+        t_vertex_id cluster_id) {
+    t_vertex_id current_cluster_id = clustermap_[vertex_id];
+    if (current_cluster_id == cluster_id)
+        return;
+
+    t_edge_count degree = graph_->GetDegree(vertex_id);
+    members_[cluster_id]->splice(members_[cluster_id]->end(),
+            *members_[current_cluster_id], positions_[vertex_id]);
+    clusterdegree_[current_cluster_id] -= degree;
+    clusterdegree_[cluster_id] += degree;
+    clustermap_[vertex_id] = cluster_id;
+}
+
+/*
+ * vertex moves as in ModOptimizer::RefineCluster, but only the seed vertices
+ * and the neighbors of moved vertices are examined
+ */
+void IncrementalUpdater::Refine(vector<t_vertex_id>* seeds) {
+    double edgeCount = graph_->get_edge_count();
+    if (edgeCount == 0)
+        return;
+
+    std::deque<t_vertex_id> queue(seeds->begin(), seeds->end());
+    boost::unordered_set<t_vertex_id> queued(seeds->begin(), seeds->end());
+
+    vector<t_vertex_id> buffer;
+    while (!queue.empty()) {
+        t_vertex_id vertex_id = queue.front();
+        queue.pop_front();
+        queued.erase(vertex_id);
+
+        vector<t_vertex_id>* neighbors = graph_->GetNeighbors(vertex_id, &buffer);
+        if (neighbors->empty())
+            continue;
+
+        links_.clear();
+        for (size_t j = 0; j < neighbors->size(); j++)
+            links_[clustermap_[neighbors->at(j)]]++;
+
+        t_vertex_id current_cluster_id = clustermap_[vertex_id];
+        t_edge_count current_links = links_[current_cluster_id];
+        double degree = neighbors->size();
+
+        t_vertex_id best_move_cluster = -1;
+        double bestDeltaQ = 0;
+        for (boost::unordered_map<t_vertex_id, t_edge_count>::iterator iter =
+                links_.begin(); iter != links_.end(); ++iter) {
+            t_vertex_id cluster_id = iter->first;
+            if (current_cluster_id == cluster_id) continue;
+
+            double deltaQ = GetMoveDeltaQ(iter->second, current_links,
+                    clusterdegree_[cluster_id],
+                    clusterdegree_[current_cluster_id], degree, edgeCount);
+            if (deltaQ > bestDeltaQ) {
+                bestDeltaQ = deltaQ;
+                best_move_cluster = cluster_id;
+            }
+        }
+
+        if (bestDeltaQ > 0) {
+            MoveVertex(vertex_id, best_move_cluster);
+            moved_vertex_count_++;
+            for (size_t j = 0; j < neighbors->size(); j++) {
+                if (queued.insert(neighbors->at(j)).second)
+                    queue.push_back(neighbors->at(j));
+            }
+        }
+    }
+}
+
+/*
+ * clusters the subgraph induced by the degraded clusters with RG and keeps
+ * the result if it improves modularity in the whole graph
+ */
+void IncrementalUpdater::Rejoin(vector<t_vertex_id>* degraded_clusters,
+        int sample_size) {
+    t_id_list region;
+    double old_q = 0;
+    BOOST_FOREACH(t_vertex_id cluster_id, *degraded_clusters) {
+        old_q += GetContribution(cluster_id);
+        region.insert(region.end(), members_[cluster_id]->begin(),
+                members_[cluster_id]->end());
+    }
+
+    if (region.size() < 2)
+        return;
+
+    Graph subgraph(graph_, &region);
+    if (subgraph.get_edge_count() == 0)
+        return;
+
+    ModOptimizer optimizer(&subgraph);
+    optimizer.SetSeed(random_->Next());
+    optimizer.ClusterRG(sample_size, 1);
+    Partition* subclusters = optimizer.GetClusters();
+    boost::unordered_map<t_vertex_id, t_vertex_id>* id_mapper =
+            subgraph.get_id_mapper();
+
+    // contribution of the new clusters to the modularity of the whole graph
+    vector<t_vertex_id> submap(subgraph.get_vertex_count());
+    for (size_t i = 0; i < subclusters->get_partition_vector()->size(); i++) {
+        BOOST_FOREACH(t_vertex_id vertex_id,
+                *subclusters->get_partition_vector()->at(i)) {
+            submap[vertex_id] = i;
+        }
+    }
+
+    double two_m = 2.0 * graph_->get_edge_count();
+    double new_q = 0;
+    vector<t_vertex_id> buffer;
+    for (size_t i = 0; i < subclusters->get_partition_vector()->size(); i++) {
+        t_edge_count internal_degree = 0;
+        t_edge_count degree = 0;
+        BOOST_FOREACH(t_vertex_id vertex_id,
+                *subclusters->get_partition_vector()->at(i)) {
+            t_vertex_id original_id = id_mapper->at(vertex_id);
+            degree += graph_->GetDegree(original_id);
+
+            vector<t_vertex_id>* neighbors = subgraph.GetNeighbors(vertex_id, &buffer);
+            for (size_t j = 0; j < neighbors->size(); j++) {
+                if (submap[neighbors->at(j)] == (t_vertex_id) i)
+                    internal_degree++;
+            }
+        }
+        double a = degree / two_m;
+        new_q += internal_degree / two_m - a * a;
+    }
+
+    if (new_q <= old_q)
+        return;
+
+    // reuse the ids of the degraded clusters, further clusters are appended
+    for (size_t i = 0; i < subclusters->get_partition_vector()->size(); i++) {
+        t_vertex_id cluster_id;
+        if (i < degraded_clusters->size()) {
+            cluster_id = degraded_clusters->at(i);
+        } else {
+            cluster_id = members_.size();
+            members_.push_back(new t_id_list());
+            clusterdegree_.push_back(0);
+        }
+
+        BOOST_FOREACH(t_vertex_id vertex_id,
+                *subclusters->get_partition_vector()->at(i)) {
+            MoveVertex(id_mapper->at(vertex_id), cluster_id);
+        }
+    }
+    rejoined_vertex_count_ += region.size();
+
+    vector<t_vertex_id> seeds(region.begin(), region.end());
+    Refine(&seeds);
+}
@@ -0,0 +1,59 @@
+//============================================================================
+// Name        : IncrementalUpdater.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : adapts an existing clustering to a batch of edge insertions
+//               and deletions by re-optimizing only the affected vertices
+//============================================================================
+
+
+#ifndef INCREMENTALUPDATER_H_
+#define INCREMENTALUPDATER_H_
+
+#include <vector>
+#include <list>
+
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+#include "indextypes.h"
+#include "partition.h"
+
+class Graph;
+class RandomSource;
+
+class IncrementalUpdater {
+public:
+    IncrementalUpdater(Graph* graph, Partition* clusters, RandomSource* random);
+    virtual ~IncrementalUpdater();
+
+    void Update(list<t_vertex_pair>* insertions, list<t_vertex_pair>* deletions,
+        int sample_size);
+    Partition* GetPartition();
+
+    t_vertex_id get_moved_vertex_count();
+    t_vertex_id get_rejoined_vertex_count();
+
+private:
+    Graph* graph_;
+    RandomSource* random_;
+
+    t_partition members_;                       // vertices of every cluster
+    vector<t_id_list::iterator> positions_;     // position of vertex in members_
+    vector<t_vertex_id> clustermap_;            // maps vertex_id -> cluster_id
+    vector<t_edge_count> clusterdegree_;        // sum of degrees of a cluster
+    boost::unordered_map<t_vertex_id, t_edge_count> links_; // reused per vertex
+
+    t_vertex_id moved_vertex_count_;
+    t_vertex_id rejoined_vertex_count_;
+
+    void AddVertices();
+    t_edge_count GetInternalDegree(t_vertex_id cluster_id);
+    double GetContribution(t_vertex_id cluster_id);
+    void MoveVertex(t_vertex_id vertex_id, t_vertex_id cluster_id);
+    void Refine(vector<t_vertex_id>* seeds);
+    void Rejoin(vector<t_vertex_id>* degraded_clusters, int sample_size);
+};
+
+#endif /* INCREMENTALUPDATER_H_ */
@@ -0,0 +1,40 @@
+//============================================================================
+// Name        : IndexTypes.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : integer types used for vertex ids and edge counts
+//============================================================================
+
+
+#ifndef INDEXTYPES_H_
+#define INDEXTYPES_H_
+
+#include <stdint.h>
+#include <utility>
+
+/*
+ * Vertex ids, cluster ids and row/column indices of the clustering matrix.
+ * 32 bit by default, build with -DRGMC_64BIT_VERTEX_IDS for graphs with
+ * more than 2^31 vertices.
+ */
+#ifdef RGMC_64BIT_VERTEX_IDS
+typedef int64_t t_vertex_id;
+#else
+typedef int32_t t_vertex_id;
+#endif
+
+/*
+ * Edge counts, degree sums and adjacency offsets. 64 bit by default, so
+ * graphs with more than 2^31 adjacency entries can be clustered with 32 bit
+ * vertex ids. Build with -DRGMC_32BIT_EDGE_COUNTS for the compact variant.
+ */
+#ifdef RGMC_32BIT_EDGE_COUNTS
+typedef int32_t t_edge_count;
+#else
+typedef int64_t t_edge_count;
+#endif
+
+typedef std::pair<t_vertex_id, t_vertex_id> t_vertex_pair;
+
+#endif /* INDEXTYPES_H_ */
@@ -0,0 +1,136 @@
+//============================================================================
+// Name        : JoinPolicies.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : policies of the join engine (ModOptimizer::PerformJoinSteps)
+//               for the start state and the sampling of rows, resolved at
+//               compile time
+//============================================================================
+
+
+#ifndef JOINPOLICIES_H_
+#define JOINPOLICIES_H_
+
+#include "indextypes.h"
+#include "clusteringworkspace.h"
+#include "graph.h"
+#include "partition.h"
+
+/*
+ * start state: every vertex is a cluster (RG). Q starts at its exact value
+ * -sum(a_i^2), a join sequence is used if it reaches Q > -1.
+ */
+class SingletonStart {
+public:
+    SingletonStart(Graph* graph) : graph_(graph) {
+    }
+
+    t_vertex_id Reset(ClusteringWorkspace* workspace) {
+        workspace->Reset(graph_);
+        return graph_->get_vertex_count();
+    }
+
+    double GetStartQ(SparseClusteringMatrix* cluster_matrix) {
+        double Q = 0;
+        for (t_vertex_id i = 0; i < graph_->get_vertex_count(); i++) {
+            double a_i = cluster_matrix->GetRowSum(i);
+            Q -= a_i * a_i;
+        }
+        return Q;
+    }
+
+    double GetMinimumQ() {
+        return -1;
+    }
+
+    Partition* GetPartition() {
+        return NULL;
+    }
+
+private:
+    Graph* graph_;
+};
+
+/*
+ * start state: the clusters of a partition (restart of CGGC). Q is counted
+ * relative to the partition, which is kept unless a join improves it.
+ */
+class PartitionStart {
+public:
+    PartitionStart(Graph* graph, Partition* clusters) :
+            graph_(graph), clusters_(clusters) {
+    }
+
+    t_vertex_id Reset(ClusteringWorkspace* workspace) {
+        workspace->Reset(graph_, clusters_);
+        return clusters_->get_partition_vector()->size();
+    }
+
+    double GetStartQ(SparseClusteringMatrix*) {
+        return 0;
+    }
+
+    double GetMinimumQ() {
+        return 0;
+    }
+
+    Partition* GetPartition() {
+        return clusters_;
+    }
+
+private:
+    Graph* graph_;
+    Partition* clusters_;
+};
+
+/*
+ * Sampling: GetSampleSize gives the number of rows scanned in a step with
+ * remaining active rows. With kRowsInOrder, or if the sample size equals
+ * remaining, all rows are scanned in order, otherwise rows are drawn at
+ * random. With kExtendWhileNegative one more row is drawn while no join with
+ * delta Q >= 0 has been found. kParallelScan allows to scan large samples
+ * with several threads.
+ */
+template <bool kExtend>
+class SampleOneRow {
+public:
+    static const bool kExtendWhileNegative = kExtend;
+    static const bool kRowsInOrder = false;
+    static const bool kParallelScan = false;
+
+    t_vertex_id GetSampleSize(t_vertex_id) const {
+        return 1;
+    }
+};
+
+template <bool kExtend>
+class SampleRows {
+public:
+    static const bool kExtendWhileNegative = kExtend;
+    static const bool kRowsInOrder = false;
+    static const bool kParallelScan = true;
+
+    SampleRows(t_vertex_id sample_size) : sample_size_(sample_size) {
+    }
+
+    t_vertex_id GetSampleSize(t_vertex_id remaining) const {
+        return sample_size_ < remaining ? sample_size_ : remaining;
+    }
+
+private:
+    t_vertex_id sample_size_;
+};
+
+class ScanAllRows {
+public:
+    static const bool kExtendWhileNegative = false;
+    static const bool kRowsInOrder = true;
+    static const bool kParallelScan = true;
+
+    t_vertex_id GetSampleSize(t_vertex_id remaining) const {
+        return remaining;
+    }
+};
+
+#endif /* JOINPOLICIES_H_ */
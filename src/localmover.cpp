@@ -0,0 +1,223 @@
+//============================================================================
+// Name        : LocalMover.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : multilevel local moving: vertices are moved to the adjacent
+//               cluster with the highest gain in modularity, then the
+//               clusters are contracted to vertices of a weighted graph and
+//               the moves are repeated on the next level
+//============================================================================
+
+
+#include "localmover.h"
+
+#include <algorithm>
+
+#include "graph.h"
+#include "partition.h"
+#include "randomsource.h"
+#include "walltime.h"
+
+// a level stops when a sweep over all vertices gains less than this
+static const double kMinSweepGain = 1e-7;
+
+LocalMover::LocalMover(Graph* graph, RandomSource* random) {
+    graph_ = graph;
+    random_ = random;
+}
+
+LocalMover::~LocalMover() {
+}
+
+/*
+ * returns the clustering of the top level, levels are added as long as
+ * vertices move. After the deadline (0 = none) the moves of the current level
+ * are contracted and no further level is started.
+ */
+Partition* LocalMover::Run(double deadline) {
+    t_vertex_id vertex_count = graph_->get_vertex_count();
+
+    // maps original vertex -> vertex of the current level
+    std::vector<t_vertex_id> membership(vertex_count);
+    for (t_vertex_id i = 0; i < vertex_count; i++)
+        membership[i] = i;
+
+    WeightedGraph levels[2];
+    WeightedGraph* level = &levels[0];
+    WeightedGraph* next_level = &levels[1];
+    BuildFromGraph(level);
+
+    while (MoveVertices(level, deadline)) {
+        Contract(level, next_level);
+        for (t_vertex_id i = 0; i < vertex_count; i++)
+            membership[i] = clustermap_[membership[i]];
+        std::swap(level, next_level);
+
+        if (deadline > 0 && GetWallTime() >= deadline) break;
+    }
+
+    Partition* result = new Partition(level->get_vertex_count());
+    for (t_vertex_id i = 0; i < vertex_count; i++)
+        result->get_partition_vector()->at(membership[i])->push_back(i);
+    result->RemoveEmptyEntries();
+    return result;
+}
+
+/*
+ * level 0: every edge has weight 1, loops are ignored as in RefineCluster
+ */
+void LocalMover::BuildFromGraph(WeightedGraph* level) {
+    t_vertex_id vertex_count = graph_->get_vertex_count();
+    level->offsets.assign(1, 0);
+    level->targets.clear();
+    level->weights.clear();
+    level->degrees.resize(vertex_count);
+
+    vector<t_vertex_id> buffer;
+    for (t_vertex_id i = 0; i < vertex_count; i++) {
+        vector<t_vertex_id>* neighbors = graph_->GetNeighbors(i, &buffer);
+        for (size_t j = 0; j < neighbors->size(); j++) {
+            if ((*neighbors)[j] == i) continue;
+            level->targets.push_back((*neighbors)[j]);
+        }
+        level->offsets.push_back(level->targets.size());
+        level->degrees[i] = neighbors->size();
+    }
+    level->weights.assign(level->targets.size(), 1.0);
+    level->edge_weight = level->targets.size() / 2.0;
+}
+
+/*
+ * starts from singletons and moves every vertex (in random order) to the
+ * adjacent cluster with the highest positive delta Q until a sweep gains
+ * less than kMinSweepGain. Returns true if any vertex was moved, the
+ * clusters are left in clustermap_.
+ */
+bool LocalMover::MoveVertices(WeightedGraph* level, double deadline) {
+    t_vertex_id vertex_count = level->get_vertex_count();
+    clustermap_.resize(vertex_count);
+    clusterdegree_.resize(vertex_count);
+    neighbor_weight_.assign(vertex_count, 0.0);
+    order_.resize(vertex_count);
+    for (t_vertex_id i = 0; i < vertex_count; i++) {
+        clustermap_[i] = i;
+        clusterdegree_[i] = level->degrees[i];
+        order_[i] = i;
+    }
+    for (t_vertex_id i = vertex_count - 1; i > 0; i--)
+        std::swap(order_[i], order_[random_->Next() % (i + 1)]);
+
+    bool moved = false;
+    double sweep_gain = kMinSweepGain;
+    while (sweep_gain >= kMinSweepGain) {
+        sweep_gain = 0;
+        for (t_vertex_id i = 0; i < vertex_count; i++) {
+            t_vertex_id vertex_id = order_[i];
+            t_vertex_id current_cluster_id = clustermap_[vertex_id];
+
+            // edge weights to the adjacent clusters, in order of appearance
+            neighbor_clusters_.clear();
+            for (t_edge_count e = level->offsets[vertex_id];
+                    e < level->offsets[vertex_id + 1]; e++) {
+                t_vertex_id cluster_id = clustermap_[level->targets[e]];
+                if (neighbor_weight_[cluster_id] == 0)
+                    neighbor_clusters_.push_back(cluster_id);
+                neighbor_weight_[cluster_id] += level->weights[e];
+            }
+
+            t_vertex_id best_move_cluster = -1;
+            double bestDeltaQ = 0;
+            double vertex_degree = level->degrees[vertex_id];
+            for (size_t j = 0; j < neighbor_clusters_.size(); j++) {
+                t_vertex_id cluster_id = neighbor_clusters_[j];
+                if (cluster_id == current_cluster_id) continue;
+
+                double deltaQ = GetMoveDeltaQ(neighbor_weight_[cluster_id],
+                        neighbor_weight_[current_cluster_id],
+                        clusterdegree_[cluster_id],
+                        clusterdegree_[current_cluster_id], vertex_degree,
+                        level->edge_weight);
+                if (deltaQ > bestDeltaQ) {
+                    bestDeltaQ = deltaQ;
+                    best_move_cluster = cluster_id;
+                }
+            }
+            for (size_t j = 0; j < neighbor_clusters_.size(); j++)
+                neighbor_weight_[neighbor_clusters_[j]] = 0;
+
+            // move vertex
+            if (best_move_cluster != -1) {
+                clusterdegree_[current_cluster_id] -= vertex_degree;
+                clusterdegree_[best_move_cluster] += vertex_degree;
+                clustermap_[vertex_id] = best_move_cluster;
+                sweep_gain += bestDeltaQ;
+                moved = true;
+            }
+        }
+
+        if (deadline > 0 && GetWallTime() >= deadline) break;
+    }
+    return moved;
+}
+
+/*
+ * builds the graph of the next level with one vertex per cluster in
+ * clustermap_, which is renumbered to the new vertex ids. Returns the number
+ * of vertices of the new level.
+ */
+t_vertex_id LocalMover::Contract(WeightedGraph* level,
+        WeightedGraph* contracted) {
+    t_vertex_id vertex_count = level->get_vertex_count();
+
+    std::vector<t_vertex_id> new_id(vertex_count, -1);
+    t_vertex_id cluster_count = 0;
+    for (t_vertex_id i = 0; i < vertex_count; i++) {
+        if (new_id[clustermap_[i]] == -1)
+            new_id[clustermap_[i]] = cluster_count++;
+    }
+    for (t_vertex_id i = 0; i < vertex_count; i++)
+        clustermap_[i] = new_id[clustermap_[i]];
+
+    // vertices sorted by cluster
+    std::vector<t_vertex_id> first(cluster_count + 1, 0);
+    for (t_vertex_id i = 0; i < vertex_count; i++)
+        first[clustermap_[i] + 1]++;
+    for (t_vertex_id c = 0; c < cluster_count; c++)
+        first[c + 1] += first[c];
+    std::vector<t_vertex_id> members(vertex_count);
+    std::vector<t_vertex_id> position(first.begin(), first.end() - 1);
+    for (t_vertex_id i = 0; i < vertex_count; i++)
+        members[position[clustermap_[i]]++] = i;
+
+    contracted->offsets.assign(1, 0);
+    contracted->targets.clear();
+    contracted->weights.clear();
+    contracted->degrees.assign(cluster_count, 0.0);
+    contracted->edge_weight = level->edge_weight;
+
+    for (t_vertex_id c = 0; c < cluster_count; c++) {
+        neighbor_clusters_.clear();
+        for (t_vertex_id m = first[c]; m < first[c + 1]; m++) {
+            t_vertex_id vertex_id = members[m];
+            contracted->degrees[c] += level->degrees[vertex_id];
+
+            for (t_edge_count e = level->offsets[vertex_id];
+                    e < level->offsets[vertex_id + 1]; e++) {
+                t_vertex_id cluster_id = clustermap_[level->targets[e]];
+                if (cluster_id == c) continue; // internal edges stay in the degree
+                if (neighbor_weight_[cluster_id] == 0)
+                    neighbor_clusters_.push_back(cluster_id);
+                neighbor_weight_[cluster_id] += level->weights[e];
+            }
+        }
+
+        for (size_t j = 0; j < neighbor_clusters_.size(); j++) {
+            contracted->targets.push_back(neighbor_clusters_[j]);
+            contracted->weights.push_back(neighbor_weight_[neighbor_clusters_[j]]);
+            neighbor_weight_[neighbor_clusters_[j]] = 0;
+        }
+        contracted->offsets.push_back(contracted->targets.size());
+    }
+    return cluster_count;
+}
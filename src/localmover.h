@@ -0,0 +1,81 @@
+//============================================================================
+// Name        : LocalMover.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : multilevel local moving: vertices are moved to the adjacent
+//               cluster with the highest gain in modularity, then the
+//               clusters are contracted to vertices of a weighted graph and
+//               the moves are repeated on the next level
+//============================================================================
+
+
+#ifndef LOCALMOVER_H_
+#define LOCALMOVER_H_
+
+#include <vector>
+
+#include "indextypes.h"
+
+class Graph;
+class Partition;
+class RandomSource;
+
+/*
+ * gain in modularity of moving a vertex from its cluster to another cluster,
+ * links are the edge weights between the vertex and the clusters, degrees the
+ * sums of the vertex degrees of the clusters (the own cluster including the
+ * vertex). Used by RefineCluster as well.
+ */
+inline double GetMoveDeltaQ(double links_to, double links_from,
+        double degree_to, double degree_from, double vertex_degree,
+        double edge_weight) {
+    double term1 = (links_to - links_from) / edge_weight;
+    double term2 = degree_to - degree_from;
+    term2 += vertex_degree;
+    term2 *= vertex_degree;
+    term2 /= 2.0;
+    term2 /= edge_weight;
+    term2 /= edge_weight;
+    return term1 - term2;
+}
+
+/*
+ * adjacency arrays of an undirected graph with weighted edges, edges inside
+ * a contracted vertex only count in its degree
+ */
+struct WeightedGraph {
+    std::vector<t_edge_count> offsets;   // neighbors of v: [offsets[v], offsets[v+1])
+    std::vector<t_vertex_id> targets;
+    std::vector<double> weights;
+    std::vector<double> degrees;
+    double edge_weight;                  // sum of all edge weights (|E|)
+
+    t_vertex_id get_vertex_count() const {
+        return degrees.size();
+    }
+};
+
+class LocalMover {
+public:
+    LocalMover(Graph* graph, RandomSource* random);
+    virtual ~LocalMover();
+
+    Partition* Run(double deadline);
+
+private:
+    Graph* graph_;
+    RandomSource* random_;
+
+    std::vector<t_vertex_id> clustermap_;     // maps vertex -> cluster on a level
+    std::vector<double> clusterdegree_;
+    std::vector<double> neighbor_weight_;     // edge weight to a cluster, reused
+    std::vector<t_vertex_id> neighbor_clusters_;
+    std::vector<t_vertex_id> order_;
+
+    void BuildFromGraph(WeightedGraph* level);
+    bool MoveVertices(WeightedGraph* level, double deadline);
+    t_vertex_id Contract(WeightedGraph* level, WeightedGraph* contracted);
+};
+
+#endif /* LOCALMOVER_H_ */
@@ -6,13 +6,16 @@
 // Description : Test application for randomized greedy modularity clustering
 //============================================================================
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <iostream>
 #include <time.h>
 #include <string>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 
 #include <boost/version.hpp>
 #include <boost/foreach.hpp>
@@ -20,117 +23,154 @@
 
 #include "modoptimizer.h"
 #include "graph.h"
+#include "clusteringjob.h"
+#include "clusteringio.h"
+#include "batchrunner.h"
+#include "clusteringserver.h"
+#include "vertexorder.h"
+#include "dendrogram.h"
+#include "numaplacement.h"
+#include "walltime.h"
 
 namespace po = boost::program_options;
 
-void StoreClustering(std::string out_filename, Partition* final_clusters,
-        Graph* graph) {
-    std::ofstream out(out_filename.data());
-    if (!out) {
-        std::cerr << "Cannot open output file.\n";
-        return;
-    }
-    std::vector<int> assingments(graph->get_vertex_count(), -1);
-    for (int i = 0; i < final_clusters->get_partition_vector()->size(); i++) {
-        BOOST_FOREACH(int vertex_id,
-                      *(final_clusters->get_partition_vector()->at(i)) ) {
-            assingments[vertex_id] = i + 1;
-        }    
-    }
-    for (int i = 0; i < graph->get_vertex_count(); i++)
-        out << assingments[i] << "\n";
-    out.close();
-}
-
 int main(int argc, char* argv[]) {
-    std::string filename;
-    std::string out_filename;
-    int k;
-    int finalk;
-    int runs;
-    int ensemblesize;
-    bool iterative;
-    bool adv;
-    int alg;
-    int seed;
+    ClusteringJob job;
+    std::string batch_filename;
+    std::string socket_path;
+    std::string server_outdir;
+    std::string cut_filename;
+    int threads;
+    int cut_steps;
+    int cut_clusters;
+    bool numa;
     
     po::options_description desc("Supported Arguments");
     desc.add_options()
             ("help", "Display this message")
-            ("file", po::value<std::string > (&filename), "input graph file")
-            ("k", po::value<int>(&k)->default_value(2), "sample size of RG")
-            ("finalk", po::value<int>(&finalk)->default_value(2000), "sample size for final RG step")
-            ("runs", po::value<int>(&runs)->default_value(1), "number of runs from which to pick the best result")
-            ("ensemblesize", po::value<int>(&ensemblesize)->default_value(-1), "size of ensemble for ensemble algorithms (-1 = ln(#vertices))")
-            ("algorithm", po::value<int>(&alg)->default_value(1), "algorithm: 1: RG, 2: CGGC_RG, 3: CGGCi_RG")
-            ("outfile", po::value<std::string> (&out_filename), "file to store the detected communities")
-            ("seed", po::value<int> (&seed), "seed value to initialize random number generator")
+            ;
+    AddClusteringOptions(&desc, &job);
+    desc.add_options()
+            ("batch", po::value<std::string> (&batch_filename), "manifest file with one job per line, each line holds options as given on the command line")
+            ("threads", po::value<int>(&threads)->default_value(1), "number of worker threads, batch mode runs one job per thread")
+            ("numa", po::bool_switch(&numa), "NUMA placement: batch workers are pinned to the nodes round robin and the graphs interleaved over the nodes, a single run with --threads interleaves all its memory")
+            ("server", po::value<std::string> (&socket_path), "keep graphs in memory and answer clustering requests on this UNIX domain socket")
+            ("server-outdir", po::value<std::string> (&server_outdir), "directory for the files requests write (--outfile, --dendrogram, --checkpoint, --ensemble-cache), without it such requests are refused")
+            ("cut", po::value<std::string> (&cut_filename), "write the clustering of a dendrogram file (see --dendrogram) to --outfile without clustering again")
+            ("cut-steps", po::value<int>(&cut_steps), "cut the dendrogram after this number of joins (default: highest Q)")
+            ("cut-clusters", po::value<int>(&cut_clusters), "cut the dendrogram at this number of clusters")
             ;
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
     po::notify(vm);
+    ReadClusteringOptions(&vm, &job);
 
     if (vm.count("help")) {
         std::cout << desc << "\n";
         return 1;
     }
 
+    if (vm.count("batch")) {
+        BatchRunner runner(threads, numa);
+        int failed_jobs = runner.Run(batch_filename);
+        return failed_jobs == 0 ? 0 : 1;
+    }
+
+    if (vm.count("server")) {
+        ClusteringServer server(socket_path, server_outdir);
+        return server.Run();
+    }
+
+    if (vm.count("cut")) {
+        Dendrogram* dendrogram = Dendrogram::Load(cut_filename);
+        if (dendrogram == NULL)
+            exit(1);
+
+        t_vertex_id steps = dendrogram->GetBestStepCount();
+        if (vm.count("cut-clusters"))
+            steps = dendrogram->GetStepsForClusterCount(cut_clusters);
+        else if (vm.count("cut-steps"))
+            steps = std::max(0, std::min(cut_steps,
+                    (int) dendrogram->get_step_count()));
+
+        std::cout << "steps: " << steps
+                << "  clusters: " << dendrogram->GetClusterCount(steps)
+                << "  Q: " << dendrogram->GetModularity(steps) << std::endl;
+
+        bool success = true;
+        if (vm.count("outfile")) {
+            std::vector<t_vertex_id>* assingments =
+                    dendrogram->CutAtSteps(steps);
+            success = StoreAssignments(job.out_filename, assingments,
+                    job.out_format);
+            delete assingments;
+        }
+        delete dendrogram;
+        return success ? 0 : 1;
+    }
+
     if (!vm.count("file")) {
         std::cout << "No filename given. Exit." << std::endl;
         exit(0);
     }
-    
-    if (!vm.count("seed")) {
-        time_t t;
-        time(&t);
-        srand((unsigned int) t);
+
+    if (!IsValidAlgorithm(job.algorithm)) {
+        std::cout << "Invalid parameter for '--algorithm'." << std::endl;
+        exit(1);
     }
-    else {
-        srand((unsigned int) seed);
+
+    if (!IsValidEnsembleBase(job.ensemble_base)) {
+        std::cout << "Invalid parameter for '--ensemblebase'." << std::endl;
+        exit(1);
     }
 
-    Graph graph(filename);
-
-    if (ensemblesize == -1) ensemblesize = log(graph.get_vertex_count());
-
-    switch (alg) {
-        case 1:
-            adv = 0;
-            iterative = 0;
-            break;
-        case 2:
-            adv = 1;
-            iterative = 0;
-            break;
-        case 3:
-            adv = 1;
-            iterative = 1;
-            break;
-        default:    
-            std::cout << "Invalid parameter for '--algorithm'." << std::endl;
-            exit(1);
+    if (!IsValidVertexOrder(job.vertex_order)) {
+        std::cout << "Invalid parameter for '--reorder'." << std::endl;
+        exit(1);
     }
 
+    if (!IsValidOutputFormat(job.out_format)) {
+        std::cout << "Invalid parameter for '--outformat'." << std::endl;
+        exit(1);
+    }
+
+    // the threads of a single run share all structures
+    NumaPlacement placement;
+    if (numa && threads > 1) {
+        if (!placement.Detect())
+            std::cerr << "NUMA placement not used: " << placement.get_error()
+                    << std::endl;
+        else if (!placement.InterleaveThreadMemory(true))
+            std::cerr << "NUMA placement not used: " << strerror(errno)
+                    << std::endl;
+    }
+
+    Graph graph(job.filename, job.compress_graph);
+    ReorderGraph(&graph, job.vertex_order);
+    FitGraphToMemoryLimit(&graph, &job);
 
-    clock_t start, end;
-    double time;
     ModOptimizer gclusterer(&graph);
-    start = clock();
-    if (adv) 
-        gclusterer.ClusterCGGC(ensemblesize, finalk, iterative);
-    else
-        gclusterer.ClusterRG(k, runs);
-    Partition* final_clusters = gclusterer.get_clusters();
+    gclusterer.SetThreads(threads);
+    double start = GetWallTime();
+    if (!RunClustering(&gclusterer, &graph, &job))
+        exit(1);
+    Partition* final_clusters = gclusterer.GetClusters();
 
-    end = clock();
-    time = (double(end) - double(start)) / CLOCKS_PER_SEC;
+    double time = GetWallTime() - start;
 
     double Q = gclusterer.GetModularityFromClustering(&graph, final_clusters);
-    std::cout << "Q: " << Q  << "  time [sec]: "<< time << std::endl;
-
-    if (vm.count("clusterfile")) {
-        StoreClustering(out_filename, final_clusters, &graph);
+    std::cout << "Q: " << Q  << "  time [sec]: "<< time
+            << GetTruncationReport(&gclusterer) << std::endl;
+    std::cout << GetCounterReport(&gclusterer, &graph);
+    std::cout << GetMemoryReport(&gclusterer, &job);
+
+    if (vm.count("outfile")) {
+        if (!StoreClustering(job.out_filename, final_clusters, &graph,
+                job.out_format))
+            exit(1);
     }
-}
 
+    if (!StoreJobDendrogram(&gclusterer, &job))
+        exit(1);
+}
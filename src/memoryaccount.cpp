@@ -0,0 +1,58 @@
+//============================================================================
+// Name        : MemoryAccount.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : bytes held by the large data structures of a clustering run,
+//               the peak per phase and the estimate used for --memory-limit
+//============================================================================
+
+
+#include "memoryaccount.h"
+
+#include "graph.h"
+#include "partition.h"
+#include "clusteringworkspace.h"
+
+// partitions held at the same time by CGGC (core groups, member, result)
+static const int kHeldPartitions = 3;
+
+/*
+ * Total of the estimate. If the join structures are released before the
+ * refinement and the refinement structures after it (release), only the
+ * larger of both is held at a time.
+ */
+size_t MemoryEstimate::GetTotal(bool release) const {
+    size_t total = bytes[kGraphMemory] + bytes[kPartitionMemory];
+    if (release) {
+        if (bytes[kJoinMemory] > bytes[kRefinementMemory])
+            return total + bytes[kJoinMemory];
+        return total + bytes[kRefinementMemory];
+    }
+    return total + bytes[kJoinMemory] + bytes[kRefinementMemory];
+}
+
+/*
+ * bytes expected at the peak of a clustering of a graph with the given size
+ */
+MemoryEstimate EstimateMemory(t_vertex_id vertex_count,
+        t_edge_count edge_count, bool compressed_graph) {
+    MemoryEstimate estimate;
+    estimate.bytes[kGraphMemory] = Graph::EstimateBytes(vertex_count,
+            edge_count, compressed_graph);
+    estimate.bytes[kJoinMemory] = ClusteringWorkspace::EstimateJoinBytes(
+            vertex_count, edge_count);
+    estimate.bytes[kRefinementMemory] =
+            ClusteringWorkspace::EstimateRefinementBytes(vertex_count,
+            edge_count);
+    estimate.bytes[kPartitionMemory] = kHeldPartitions *
+            Partition::EstimateBytes(vertex_count);
+    return estimate;
+}
+
+const char* GetMemoryItemName(MemoryItem item) {
+    static const char* names[kMemoryItemCount] = {
+        "graph", "joins", "refinement", "partitions"
+    };
+    return names[item];
+}
@@ -0,0 +1,49 @@
+//============================================================================
+// Name        : MemoryAccount.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : bytes held by the large data structures of a clustering run,
+//               the peak per phase and the estimate used for --memory-limit
+//============================================================================
+
+
+#ifndef MEMORYACCOUNT_H_
+#define MEMORYACCOUNT_H_
+
+#include <stddef.h>
+#include <string>
+
+#include "indextypes.h"
+
+enum MemoryItem {
+    kGraphMemory = 0,     // neighbor lists and id maps
+    kJoinMemory,          // cluster matrix, active rows and joins
+    kRefinementMemory,    // links of the vertices to the clusters
+    kPartitionMemory,     // partitions held by CGGC
+    kMemoryItemCount
+};
+
+/*
+ * peak bytes of every item and of their sum during one phase
+ */
+struct PhaseMemory {
+    std::string phase;
+    size_t peak[kMemoryItemCount];
+    size_t peak_total;
+};
+
+/*
+ * bytes of every item expected for a graph at the peak of a run
+ */
+struct MemoryEstimate {
+    size_t bytes[kMemoryItemCount];
+
+    size_t GetTotal(bool release) const;
+};
+
+const char* GetMemoryItemName(MemoryItem item);
+MemoryEstimate EstimateMemory(t_vertex_id vertex_count,
+    t_edge_count edge_count, bool compressed_graph);
+
+#endif /* MEMORYACCOUNT_H_ */
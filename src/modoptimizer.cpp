@@ -9,34 +9,472 @@
 
 #include "modoptimizer.h"
 
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
 #include <boost/foreach.hpp>
 
 #include "sparseclusteringmatrix.h"
 #include "activerowset.h"
 #include "graph.h"
 #include "partition.h"
+#include "incrementalupdater.h"
+#include "localmover.h"
+#include "joinpolicies.h"
+#include "graphreduction.h"
+#include "dendrogram.h"
+#include "checkpoint.h"
+#include "walltime.h"
 
 using namespace std;
 
 ModOptimizer::ModOptimizer(Graph* graph) {
     graph_ = graph;
     clusters_ = NULL;
+    initial_partition_ = NULL;
+    deadline_ = 0;
+    phase_ = "";
+    local_moving_ensemble_ = false;
+    folded_partition_ = NULL;
+    multi_join_ = false;
+    threads_ = 1;
+    record_dendrogram_ = false;
+    record_joins_ = false;
+    run_dendrogram_ = NULL;
+    dendrogram_ = NULL;
+    resume_ = false;
+    perf_counters_ = NULL;
+    joins_executed_ = 0;
+    phase_start_joins_ = 0;
+    phase_start_time_ = 0;
+    memory_limit_ = 0;
+    release_memory_ = false;
+    memory_exceeded_ = false;
+    held_partition_bytes_ = 0;
 }
 
 ModOptimizer::~ModOptimizer() {
     delete clusters_;
+    delete folded_partition_;
+    delete run_dendrogram_;
+    delete dendrogram_;
+    delete perf_counters_;
 }
 
 Partition* ModOptimizer::GetClusters() {
     return clusters_;
 }
 
+void ModOptimizer::SetSeed(unsigned int seed) {
+    random_.Seed(seed);
+}
+
+/*
+ * sets a partition (e.g. the result of an earlier run) that ClusterCGGC uses
+ * as first member of the ensemble, the partition is not taken over
+ */
+void ModOptimizer::SetInitialPartition(Partition* partition) {
+    initial_partition_ = partition;
+}
+
+/*
+ * sets the wall clock time (see GetWallTime()) at which all phases stop and
+ * the best partition found so far is returned, 0 disables the limit
+ */
+void ModOptimizer::SetDeadline(double deadline) {
+    deadline_ = deadline;
+    truncated_phases_.clear();
+}
+
+/*
+ * number of threads used to build the cluster matrix of the join steps and to
+ * scan the rows of a multi-join round, the result does not depend on it
+ */
+void ModOptimizer::SetThreads(int threads) {
+    threads_ = threads < 1 ? 1 : threads;
+    workspace_.SetThreads(threads);
+}
+
+/*
+ * builds the ensemble members of ClusterCGGC by multilevel local moving
+ * instead of RG, which is much faster on large graphs
+ */
+void ModOptimizer::SetLocalMovingEnsemble(bool local_moving) {
+    local_moving_ensemble_ = local_moving;
+}
+
+/*
+ * RG runs (also those of the ensemble) start with every pendant vertex in
+ * the cluster of its neighbor instead of singletons, see FoldPendantVertices
+ */
+void ModOptimizer::SetPendantFolding(bool fold) {
+    delete folded_partition_;
+    folded_partition_ = fold ? FoldPendantVertices(graph_) : NULL;
+}
+
+/*
+ * RG runs (also those of the ensemble) execute a set of disjoint joins per
+ * round instead of one join per step, see PerformMatchingJoins
+ */
+void ModOptimizer::SetMultiJoin(bool multi_join) {
+    multi_join_ = multi_join;
+}
+
+/*
+ * keeps the complete join sequence of the RG step that yields the result (the
+ * best run of ClusterRG, the final step of ClusterCGGC and ClusterWarmStart),
+ * see GetDendrogram
+ */
+void ModOptimizer::SetDendrogramRecording(bool record) {
+    record_dendrogram_ = record;
+}
+
+/*
+ * returns the recorded join sequence of the last clustering or NULL, the
+ * dendrogram is owned by the optimizer
+ */
+Dendrogram* ModOptimizer::GetDendrogram() {
+    return dendrogram_;
+}
+
+/*
+ * ClusterCGGC writes its state to the file after every ensemble member and
+ * every CGGCi iteration. With resume it continues from the state in the file
+ * if the file exists and belongs to the same graph, ensemble size and
+ * ensemble key.
+ */
+void ModOptimizer::SetCheckpoint(std::string filename, bool resume) {
+    checkpoint_filename_ = filename;
+    resume_ = resume;
+}
+
+/*
+ * The key names the options and the seed the ensemble depends on (see
+ * GetEnsembleKey). It is stored in checkpoints and cached ensembles, which
+ * are only used by runs with the same key.
+ */
+void ModOptimizer::SetEnsembleKey(std::string key) {
+    ensemble_key_ = key;
+}
+
+/*
+ * returns the core groups of the checkpoint and restores the random state,
+ * NULL if there is no checkpoint to resume from
+ */
+Partition* ModOptimizer::ReadCheckpoint(int ensemble_size, bool iterative,
+        CGGCCheckpoint* checkpoint) {
+    if (!resume_ || checkpoint_filename_.empty())
+        return NULL;
+
+    Partition* clusters = LoadCheckpoint(checkpoint_filename_, graph_,
+            checkpoint);
+    if (clusters == NULL)
+        return NULL;
+
+    if (checkpoint->ensemble_size != ensemble_size ||
+            checkpoint->iterative != (iterative ? 1 : 0) ||
+            (checkpoint->stage != kEnsembleStage &&
+                    checkpoint->stage != kIterationStage) ||
+            ensemble_key_ != checkpoint->ensemble_key ||
+            !random_.SetState(&checkpoint->random_state)) {
+        std::cerr << "Checkpoint was written by another algorithm, other "
+                "ensemble options or another seed, starting from scratch.\n";
+        delete clusters;
+        return NULL;
+    }
+    return clusters;
+}
+
+void ModOptimizer::WriteCheckpoint(int ensemble_size, bool iterative,
+        int stage, int progress, double cur_q, double last_q,
+        Partition* clusters) {
+    if (checkpoint_filename_.empty())
+        return;
+
+    CGGCCheckpoint checkpoint;
+    FillCheckpoint(ensemble_size, iterative, stage, progress, cur_q, last_q,
+            &checkpoint);
+    StoreCheckpoint(checkpoint_filename_, graph_, &checkpoint, clusters);
+}
+
+/*
+ * the state of the run for a checkpoint or the ensemble cache
+ */
+void ModOptimizer::FillCheckpoint(int ensemble_size, bool iterative,
+        int stage, int progress, double cur_q, double last_q,
+        CGGCCheckpoint* checkpoint) {
+    memset(checkpoint, 0, sizeof(CGGCCheckpoint));
+    checkpoint->ensemble_size = ensemble_size;
+    checkpoint->iterative = iterative ? 1 : 0;
+    checkpoint->stage = stage;
+    checkpoint->progress = progress;
+    checkpoint->cur_q = cur_q;
+    checkpoint->last_q = last_q;
+    random_.GetState(&checkpoint->random_state);
+    strncpy(checkpoint->ensemble_key, ensemble_key_.data(),
+            kEnsembleKeySize - 1);
+}
+
+/*
+ * Core groups of ClusterCGGC are stored in filename.ensemble after the
+ * ensemble and (CGGCi) in filename.iterations after the last iteration,
+ * later runs load them instead of computing them again. The caller chooses
+ * a filename that is unique for the graph, the seed and all options that
+ * change the ensemble, an empty filename disables the cache.
+ */
+void ModOptimizer::SetEnsembleCache(std::string filename) {
+    ensemble_cache_ = filename;
+}
+
+/*
+ * returns the cached core groups of the latest stage available for the
+ * algorithm and restores the random state, NULL if there are none
+ */
+Partition* ModOptimizer::ReadEnsembleCache(int ensemble_size, bool iterative,
+        CGGCCheckpoint* checkpoint) {
+    if (ensemble_cache_.empty() || initial_partition_ != NULL)
+        return NULL;
+
+    for (int stage = iterative ? kIterationStage : kEnsembleStage;
+            stage >= kEnsembleStage; stage--) {
+        std::string filename = ensemble_cache_ +
+                (stage == kIterationStage ? ".iterations" : ".ensemble");
+        Partition* clusters = LoadCheckpoint(filename, graph_, checkpoint);
+        if (clusters == NULL)
+            continue;
+        if (checkpoint->ensemble_size == ensemble_size &&
+                checkpoint->stage == stage &&
+                ensemble_key_ == checkpoint->ensemble_key &&
+                random_.SetState(&checkpoint->random_state))
+            return clusters;
+        delete clusters;
+    }
+    return NULL;
+}
+
+/*
+ * stores the core groups of a complete stage, not if a phase was cut short
+ */
+void ModOptimizer::WriteEnsembleCache(int ensemble_size, int stage,
+        int progress, double cur_q, double last_q, Partition* clusters) {
+    if (ensemble_cache_.empty() || initial_partition_ != NULL ||
+            !truncated_phases_.empty())
+        return;
+
+    CGGCCheckpoint checkpoint;
+    FillCheckpoint(ensemble_size, stage == kIterationStage, stage, progress,
+            cur_q, last_q, &checkpoint);
+    StoreCheckpoint(ensemble_cache_ +
+            (stage == kIterationStage ? ".iterations" : ".ensemble"), graph_,
+            &checkpoint, clusters);
+}
+
+/*
+ * the recording of the last join phase becomes the dendrogram of the result
+ * or is dropped
+ */
+void ModOptimizer::KeepRunDendrogram(bool keep) {
+    if (keep && run_dendrogram_ != NULL) {
+        delete dendrogram_;
+        dendrogram_ = run_dendrogram_;
+    } else
+        delete run_dendrogram_;
+    run_dendrogram_ = NULL;
+}
+
+/*
+ * stores the executed joins and Q after each of them (in join_q_) as
+ * run_dendrogram_. Q of a partition start is relative to the partition.
+ */
+void ModOptimizer::RecordJoins(Partition* start_partition,
+        t_vertex_id step_count, double start_q) {
+    double offset = 0;
+    if (start_partition != NULL)
+        offset = GetModularityFromClustering(graph_, start_partition);
+    for (t_vertex_id i = 0; i < step_count; i++)
+        join_q_[i] += offset;
+
+    delete run_dendrogram_;
+    run_dendrogram_ = new Dendrogram(graph_, start_partition,
+            workspace_.get_joins(), &join_q_, step_count, start_q + offset);
+}
+
+/*
+ * counts hardware events per phase (see GetPhaseCounters), returns false if
+ * no counter is available, e.g. if perf_event_open is not permitted
+ */
+bool ModOptimizer::EnablePerfCounters() {
+    if (perf_counters_ == NULL) {
+        perf_counters_ = new PerfCounters();
+        perf_counters_->Open();
+    }
+    return perf_counters_->IsAnyAvailable();
+}
+
+PerfCounters* ModOptimizer::GetPerfCounters() {
+    return perf_counters_;
+}
+
+/*
+ * counters, time and joins of every phase of the clusterings so far
+ */
+vector<PhaseCounters>* ModOptimizer::GetPhaseCounters() {
+    return &phase_counters_;
+}
+
+/*
+ * starts a phase (reported by CheckDeadline), the counters since the start
+ * of the previous phase are added to it. An empty name ends the last phase.
+ */
+void ModOptimizer::EnterPhase(const char* phase) {
+    if (perf_counters_ != NULL) {
+        uint64_t values[kPerfCounterCount];
+        perf_counters_->Read(values);
+        double time = GetWallTime();
+
+        if (phase_[0] != '\0') {
+            size_t i = 0;
+            while (i < phase_counters_.size() && phase_counters_[i].phase != phase_)
+                i++;
+            if (i == phase_counters_.size()) {
+                PhaseCounters counters;
+                memset(counters.values, 0, sizeof(counters.values));
+                counters.phase = phase_;
+                counters.time = 0;
+                counters.joins = 0;
+                phase_counters_.push_back(counters);
+            }
+
+            PhaseCounters& counters = phase_counters_[i];
+            counters.time += time - phase_start_time_;
+            counters.joins += joins_executed_ - phase_start_joins_;
+            for (int j = 0; j < kPerfCounterCount; j++)
+                counters.values[j] += values[j] - phase_start_values_[j];
+        }
+
+        memcpy(phase_start_values_, values, sizeof(values));
+        phase_start_time_ = time;
+        phase_start_joins_ = joins_executed_;
+    }
+    phase_ = phase;
+}
+
+/*
+ * returns the phases that were cut short by the deadline or the memory limit
+ */
+vector<string>* ModOptimizer::GetTruncatedPhases() {
+    return &truncated_phases_;
+}
+
+/*
+ * Limits the bytes held by the graph and the clustering structures, 0
+ * disables the limit. If the estimate for the graph (stored in estimate)
+ * exceeds the limit, the join and refinement structures are freed after
+ * every use instead of being kept for the next run. Returns false if even
+ * then the estimate exceeds the limit. A phase that exceeds the limit
+ * anyway is cut short like at the deadline.
+ */
+bool ModOptimizer::SetMemoryLimit(size_t bytes, MemoryEstimate* estimate) {
+    *estimate = EstimateMemory(graph_->get_vertex_count(),
+            graph_->get_edge_count(), graph_->IsCompressed());
+    estimate->bytes[kGraphMemory] = graph_->GetMemoryBytes();
+
+    memory_limit_ = bytes;
+    memory_exceeded_ = false;
+    release_memory_ = bytes > 0 && estimate->GetTotal(false) > bytes;
+    return bytes == 0 || estimate->GetTotal(true) <= bytes;
+}
+
+bool ModOptimizer::IsMemoryLimitExceeded() {
+    return memory_exceeded_;
+}
+
+/*
+ * peak bytes of every phase so far, only recorded with a memory limit or
+ * with the performance counters enabled
+ */
+vector<PhaseMemory>* ModOptimizer::GetPhaseMemory() {
+    return &phase_memory_;
+}
+
+/*
+ * measures the bytes held now, updates the peaks of the current phase and
+ * checks the memory limit. Called where the structures of a phase are at
+ * their largest.
+ */
+void ModOptimizer::UpdateMemory() {
+    if (memory_limit_ == 0 && perf_counters_ == NULL)
+        return;
+
+    size_t bytes[kMemoryItemCount];
+    bytes[kGraphMemory] = graph_->GetMemoryBytes();
+    bytes[kJoinMemory] = workspace_.GetJoinBytes();
+    bytes[kRefinementMemory] = workspace_.GetRefinementBytes();
+    bytes[kPartitionMemory] = held_partition_bytes_;
+    size_t total = 0;
+    for (int i = 0; i < kMemoryItemCount; i++)
+        total += bytes[i];
+
+    if (memory_limit_ > 0 && total > memory_limit_)
+        memory_exceeded_ = true;
+    if (phase_[0] == '\0')
+        return;
+
+    size_t i = 0;
+    while (i < phase_memory_.size() && phase_memory_[i].phase != phase_)
+        i++;
+    if (i == phase_memory_.size()) {
+        PhaseMemory memory;
+        memset(memory.peak, 0, sizeof(memory.peak));
+        memory.phase = phase_;
+        memory.peak_total = 0;
+        phase_memory_.push_back(memory);
+    }
+
+    PhaseMemory& memory = phase_memory_[i];
+    for (int j = 0; j < kMemoryItemCount; j++)
+        memory.peak[j] = std::max(memory.peak[j], bytes[j]);
+    memory.peak_total = std::max(memory.peak_total, total);
+}
+
+/*
+ * partitions held by CGGC besides the structures of the current phase
+ */
+void ModOptimizer::SetHeldPartitions(Partition* partition1,
+        Partition* partition2) {
+    held_partition_bytes_ = 0;
+    if (partition1 != NULL)
+        held_partition_bytes_ += partition1->GetMemoryBytes();
+    if (partition2 != NULL)
+        held_partition_bytes_ += partition2->GetMemoryBytes();
+}
+
+/*
+ * returns true if the deadline has passed or the memory limit was exceeded
+ * and records the current phase as cut short
+ */
+bool ModOptimizer::CheckDeadline() {
+    if (!memory_exceeded_ && (deadline_ <= 0 || GetWallTime() < deadline_))
+        return false;
+
+    if (std::find(truncated_phases_.begin(), truncated_phases_.end(), phase_) ==
+            truncated_phases_.end())
+        truncated_phases_.push_back(phase_);
+    return true;
+}
+
 void ModOptimizer::ClusterRG(int k, int runs) {
     Partition* best_partition = NULL;
     double best_q = -1;
 
+    EnterPhase("rg");
+    record_joins_ = record_dendrogram_;
     for (int i = 0; i < runs; i++) {
+        if (i > 0 && CheckDeadline()) break;
+
         double Q = PerformJoins(k);
+        KeepRunDendrogram(Q > best_q);
         if (Q > best_q) {
             if (best_q != -1)
                 delete best_partition;
@@ -47,9 +485,77 @@ void ModOptimizer::ClusterRG(int k, int runs) {
         else 
             delete clusters_;
     }
+    record_joins_ = false;
+
+    EnterPhase("refinement");
+    clusters_ = RefineCluster(graph_, best_partition);
+    delete best_partition;
+    EnterPhase("");
+}
+
+/*
+ * multilevel local moving, the best of several runs is refined
+ */
+void ModOptimizer::ClusterLocalMoving(int runs) {
+    Partition* best_partition = NULL;
+    double best_q = -1;
+
+    EnterPhase("localmoving");
+    for (int i = 0; i < runs; i++) {
+        if (i > 0 && CheckDeadline()) break;
+
+        LocalMover mover(graph_, &random_);
+        Partition* partition = mover.Run(deadline_);
+        double Q = GetModularityFromClustering(graph_, partition);
+        if (Q > best_q) {
+            delete best_partition;
+            best_q = Q;
+            best_partition = partition;
+        } else
+            delete partition;
+    }
+    CheckDeadline();
 
+    EnterPhase("refinement");
     clusters_ = RefineCluster(graph_, best_partition);
     delete best_partition;
+    EnterPhase("");
+}
+
+/*
+ * one member of the ensemble, same as ClusterRG(1, 1) or with local moving
+ * ClusterLocalMoving(1)
+ */
+Partition* ModOptimizer::BuildEnsembleMember() {
+    Partition* base_partition;
+    if (local_moving_ensemble_) {
+        LocalMover mover(graph_, &random_);
+        base_partition = mover.Run(deadline_);
+    } else {
+        PerformJoins(1);
+        base_partition = clusters_;
+    }
+    Partition* result = RefineCluster(graph_, base_partition);
+    delete base_partition;
+    return result;
+}
+
+/*
+ * with a deadline or a memory limit, a copy of the best ensemble member is
+ * kept as fallback for the case that the later phases are cut short. Not if
+ * the memory is so tight that the structures are released after every use.
+ */
+void ModOptimizer::KeepBestMember(Partition* member, Partition** best_member,
+        double* best_member_q) {
+    if ((deadline_ <= 0 && memory_limit_ == 0) || release_memory_)
+        return;
+
+    double q = GetModularityFromClustering(graph_, member);
+    if (q > *best_member_q) {
+        delete *best_member;
+        *best_member = member->Copy();
+        *best_member_q = q;
+    }
 }
 
 void ModOptimizer::ClusterCGGC(int initclusters, int restartk,
@@ -57,34 +563,88 @@ void ModOptimizer::ClusterCGGC(int initclusters, int restartk,
     Partition* currentCluster;
     Partition* lastCluster;
     Partition* tmpCluster;
+    Partition* best_member = NULL;
+    double best_member_q = -1;
+
+    CGGCCheckpoint checkpoint;
+    Partition* resumed = ReadEnsembleCache(initclusters, iterative,
+            &checkpoint);
+    bool cached = resumed != NULL;
+    if (!cached)
+        resumed = ReadCheckpoint(initclusters, iterative, &checkpoint);
+    int first_member = 1;
+
+    EnterPhase("ensemble");
+    if (resumed != NULL) {
+        lastCluster = resumed;
+        if (checkpoint.stage == kEnsembleStage)
+            first_member = checkpoint.progress;
+        else
+            first_member = initclusters;
+    } else {
+        if (initial_partition_ != NULL) {
+            lastCluster = initial_partition_->Copy();
+            lastCluster->RemoveEmptyEntries();
+        } else {
+            lastCluster = BuildEnsembleMember();
+        }
+        KeepBestMember(lastCluster, &best_member, &best_member_q);
+        WriteCheckpoint(initclusters, iterative, kEnsembleStage, 1, 0, 0,
+                lastCluster);
+    }
+    SetHeldPartitions(lastCluster, best_member);
+
+    for (int i = first_member; i < initclusters; i++) {
+        if (CheckDeadline()) break;
 
-    ClusterRG(1, 1);
-    lastCluster = clusters_;
-    for (int i = 1; i < initclusters; i++) {
-        ClusterRG(1, 1);
-        currentCluster = clusters_;
+        currentCluster = BuildEnsembleMember();
+        if (CheckDeadline()) { // member may be incomplete
+            delete currentCluster;
+            break;
+        }
+        KeepBestMember(currentCluster, &best_member, &best_member_q);
         tmpCluster = CompareClusters(graph_, lastCluster, currentCluster);
 
         delete currentCluster;
         delete lastCluster;
         lastCluster = tmpCluster;
+        SetHeldPartitions(lastCluster, best_member);
+        WriteCheckpoint(initclusters, iterative, kEnsembleStage, i + 1, 0, 0,
+                lastCluster);
     }
 
     Partition* bestClustering = lastCluster;
+    if (!cached && (resumed == NULL || checkpoint.stage == kEnsembleStage))
+        WriteEnsembleCache(initclusters, kEnsembleStage, initclusters, 0, 0,
+                bestClustering);
 
     if (iterative) {
-        double cur_q = GetModularityFromClustering(graph_, bestClustering);
-        double last_q = 0;
+        EnterPhase("iterations");
+        double cur_q, last_q;
+        int iteration = 0;
+        if (resumed != NULL && checkpoint.stage == kIterationStage) {
+            cur_q = checkpoint.cur_q;
+            last_q = checkpoint.last_q;
+            iteration = checkpoint.progress;
+        } else {
+            cur_q = GetModularityFromClustering(graph_, bestClustering);
+            last_q = 0;
+        }
 
-        while ((cur_q - last_q) > 0.0001) {
+        // an iteration cut short still yields valid core groups, they are
+        // only kept if they improve Q
+        while ((cur_q - last_q) > 0.0001 && !CheckDeadline()) {
             lastCluster = PerformJoinsRestart(graph_, bestClustering, 1);
             for (int i = 1; i < initclusters; i++) {
+                if (CheckDeadline()) break;
+
                 currentCluster = PerformJoinsRestart(graph_, bestClustering, 1);
                 tmpCluster = CompareClusters(graph_, lastCluster, currentCluster);
 
                 delete currentCluster;
                 delete lastCluster;
                 lastCluster = tmpCluster;
+                SetHeldPartitions(bestClustering, lastCluster);
             }
             last_q = cur_q;
             cur_q = GetModularityFromClustering(graph_, lastCluster);
@@ -94,22 +654,90 @@ void ModOptimizer::ClusterCGGC(int initclusters, int restartk,
                 bestClustering = lastCluster;
             } else
                 delete lastCluster;
+            SetHeldPartitions(bestClustering, best_member);
+
+            // a checkpoint holds complete iterations only
+            if (!CheckDeadline())
+                WriteCheckpoint(initclusters, iterative, kIterationStage,
+                        ++iteration, cur_q, last_q, bestClustering);
         }
+
+        if (!cached || checkpoint.stage != kIterationStage)
+            WriteEnsembleCache(initclusters, kIterationStage, iteration,
+                    cur_q, last_q, bestClustering);
     }
 
+    EnterPhase("restart");
+    record_joins_ = record_dendrogram_;
     Partition* joinrestartclusters = PerformJoinsRestart(graph_, bestClustering, restartk);
+    record_joins_ = false;
+    KeepRunDendrogram(true);
     delete bestClustering;
+    EnterPhase("refinement");
     Partition* result = RefineCluster(graph_, joinrestartclusters);
     delete joinrestartclusters;
+
+    if (best_member != NULL) {
+        if (!truncated_phases_.empty() &&
+                GetModularityFromClustering(graph_, result) < best_member_q) {
+            delete result;
+            result = best_member;
+            delete dendrogram_; // result does not come from the joins
+            dendrogram_ = NULL;
+        } else
+            delete best_member;
+    }
+    held_partition_bytes_ = 0;
     clusters_ = result;
+    EnterPhase("");
 }
 
-vector<int>* ModOptimizer::GetMembershipFromPartition(Partition* partition,
-                                                     int vertex_count) {
-    vector<int>* membership = new vector<int>(vertex_count);
+/*
+ * applies edge insertions and deletions to the graph and adapts the given
+ * clustering of the graph before the changes. Only the vertices touched by
+ * the changes and their surroundings are re-optimized, clusters that got
+ * worse are re-clustered by RG with the given sample size.
+ */
+void ModOptimizer::UpdateClustering(Partition* clusters,
+        list<t_vertex_pair>* insertions, list<t_vertex_pair>* deletions,
+        int sample_size) {
+    IncrementalUpdater updater(graph_, clusters, &random_);
+    updater.Update(insertions, deletions, sample_size);
+
+    Partition* result = updater.GetPartition();
+    delete clusters_;
+    clusters_ = result;
+}
+
+/*
+ * skips the ensemble and starts the final RG step and refinement from the
+ * given partition, e.g. the result of a run on a slightly different graph
+ */
+void ModOptimizer::ClusterWarmStart(Partition* partition, int restartk) {
+    Partition* start_partition = partition->Copy();
+    start_partition->RemoveEmptyEntries();
+
+    EnterPhase("restart");
+    record_joins_ = record_dendrogram_;
+    Partition* joinrestartclusters = PerformJoinsRestart(graph_, start_partition,
+            restartk);
+    record_joins_ = false;
+    KeepRunDendrogram(true);
+    delete start_partition;
+    EnterPhase("refinement");
+    Partition* result = RefineCluster(graph_, joinrestartclusters);
+    delete joinrestartclusters;
+    delete clusters_;
+    clusters_ = result;
+    EnterPhase("");
+}
+
+vector<t_vertex_id>* ModOptimizer::GetMembershipFromPartition(Partition* partition,
+                                                     t_vertex_id vertex_count) {
+    vector<t_vertex_id>* membership = new vector<t_vertex_id>(vertex_count);
     for (size_t i = 0; i < partition->get_partition_vector()->size(); i++) {
-        list<int>* cluster = partition->get_partition_vector()->at(i);
-        BOOST_FOREACH(int vertex_id, *cluster) {
+        t_id_list* cluster = partition->get_partition_vector()->at(i);
+        BOOST_FOREACH(t_vertex_id vertex_id, *cluster) {
             membership->at(vertex_id) = i;
         }
     }
@@ -119,7 +747,7 @@ vector<int>* ModOptimizer::GetMembershipFromPartition(Partition* partition,
 Partition* ModOptimizer::CompareClusters(Graph* graph,
         Partition* partition1, Partition* partition2) {
     
-    vector<vector<int>* > maps;
+    vector<vector<t_vertex_id>* > maps;
     maps.push_back(GetMembershipFromPartition(partition1, 
                                               graph->get_vertex_count()));
     maps.push_back(GetMembershipFromPartition(partition2,
@@ -128,19 +756,19 @@ Partition* ModOptimizer::CompareClusters(Graph* graph,
     Partition* result_clustering = new Partition();
     std::vector<bool> assigned(graph->get_vertex_count(), false);
 
-    list<int>* newcluster = NULL;
+    t_id_list* newcluster = NULL;
     for (size_t i = 0; i < partition1->get_partition_vector()->size(); i++) {
-        list<int>* cluster = partition1->get_partition_vector()->at(i);
-        BOOST_FOREACH(int vertex1, *cluster) {
+        t_id_list* cluster = partition1->get_partition_vector()->at(i);
+        BOOST_FOREACH(t_vertex_id vertex1, *cluster) {
             if (!assigned[vertex1]) {
-                newcluster = new list<int>();
+                newcluster = new t_id_list();
                 result_clustering->get_partition_vector()->push_back(newcluster);
                 newcluster->push_back(vertex1);
                 assigned[vertex1] = true;
             } else
                 continue;
 
-            BOOST_FOREACH(int vertex2, *cluster) {
+            BOOST_FOREACH(t_vertex_id vertex2, *cluster) {
                 if (!assigned[vertex2]) {
                     if (maps[1]->at(vertex1) == maps[1]->at(vertex2)) {
                         newcluster->push_back(vertex2);
@@ -154,229 +782,452 @@ Partition* ModOptimizer::CompareClusters(Graph* graph,
     return result_clustering;
 }
 
+/*
+ * RG from singletons or from the folded pendant vertices, the result is
+ * stored in clusters_
+ */
 double ModOptimizer::PerformJoins(int sample_size) {
-    ActiveRowSet active_rows(graph_->get_vertex_count());
-    SparseClusteringMatrix cluster_matrix(graph_);
-
-    int dimension = graph_->get_vertex_count();
-    vector<pair<int, int> > joins(dimension - 1);
-    int best_step = -1;
-    double best_step_q = -1;
-
-    //**********
-    // calc initial Q
-    //**********
-    double Q = 0;
-    for (int i = 0; i < dimension; i++) {
-        double a_i = cluster_matrix.GetRowSum(i);
-        Q -= a_i * a_i;
+    double best_q;
+    if (folded_partition_ != NULL) {
+        PartitionStart start(graph_, folded_partition_);
+        clusters_ = PerformSampledJoins(&start, sample_size,
+                folded_partition_->get_partition_vector()->size(), &best_q);
+    } else {
+        SingletonStart start(graph_);
+        clusters_ = PerformSampledJoins(&start, sample_size,
+                graph_->get_vertex_count(), &best_q);
     }
+    return best_q;
+}
 
-    //**********
-    // perform joins
-    //**********
+/*
+ * A sample size of less than half the rows samples one row per step (as RG
+ * always did), a sample size covering all rows scans every row.
+ */
+template <class StartPolicy>
+Partition* ModOptimizer::PerformSampledJoins(StartPolicy* start,
+        int sample_size, t_vertex_id dimension, double* best_q) {
+    if (multi_join_)
+        return PerformMatchingJoins(start, best_q);
+    if (sample_size < dimension / 2)
+        return PerformJoinSteps(start, SampleOneRow<false>(), best_q);
+    if (sample_size >= dimension - 1)
+        return PerformJoinSteps(start, ScanAllRows(), best_q);
+    return PerformJoinSteps(start, SampleRows<false>(sample_size), best_q);
+}
 
-    for (int step = 0; step < graph_->get_vertex_count() - 1; step++) {
+/*
+ * RG starting from the clusters of a partition, more rows than k_restart_ are
+ * sampled in a step while no join with delta Q >= 0 is found
+ */
+Partition* ModOptimizer::PerformJoinsRestart(Graph* graph, Partition* clusters,
+                                             int k_restart_) {
+    PartitionStart start(graph, clusters);
+    t_vertex_id dimension = clusters->get_partition_vector()->size();
+    double best_q;
+
+    if (k_restart_ == 1)
+        return PerformJoinSteps(&start, SampleOneRow<true>(), &best_q);
+    if (k_restart_ >= dimension - 1)
+        return PerformJoinSteps(&start, ScanAllRows(), &best_q);
+    return PerformJoinSteps(&start, SampleRows<true>(k_restart_), &best_q);
+}
 
-        int max_sample;
-        if (sample_size < graph_->get_vertex_count() / 2) {
-            max_sample = 1;
-        } else if (sample_size < (graph_->get_vertex_count() - 1 - step)) {
-            max_sample = sample_size;
-        } else {
-            max_sample = graph_->get_vertex_count() - 1 - step;
+/*
+ * join proposed by a row in a round of PerformMatchingJoins
+ */
+struct JoinCandidate {
+    double delta_q;
+    t_vertex_pair join;
+};
+
+/*
+ * result of scanning a row, the ties are stored in the tie buffer of the
+ * thread that scanned the row
+ */
+struct RowScan {
+    double max_delta_q;
+    int thread;
+    size_t first_tie;
+    size_t tie_count;
+};
+
+// rows per thread below which a round is scanned by fewer threads
+static const size_t kMinRowsPerScanThread = 1024;
+// sampled rows per thread below which a join step is scanned by fewer threads
+static const t_vertex_id kMinSampleRowsPerScanThread = 128;
+
+static bool HasHigherDeltaQ(const JoinCandidate& a, const JoinCandidate& b) {
+    return a.delta_q > b.delta_q;
+}
+
+/*
+ * scans a block of rows per thread for the rounds of PerformMatchingJoins
+ */
+class RowScanTask : public ScanTask {
+public:
+    RowScanTask(SparseClusteringMatrix* cluster_matrix,
+            const vector<t_vertex_id>* rows, vector<DeltaQScanner>* scanners,
+            vector<RowScan>* scans, vector<vector<t_vertex_pair> >* ties) :
+            cluster_matrix_(cluster_matrix), rows_(rows), scanners_(scanners),
+            scans_(scans), ties_(ties) {}
+
+    void Run(int thread, int threads) {
+        size_t first = rows_->size() * thread / threads;
+        size_t last = rows_->size() * (thread + 1) / threads;
+        DeltaQScanner& scanner = (*scanners_)[thread];
+        vector<t_vertex_pair>& ties = (*ties_)[thread];
+
+        // ScanRow only appends ties while the maximum does not increase, the
+        // ties of the earlier rows have to be kept apart
+        vector<t_vertex_pair> row_ties;
+        ties.clear();
+        for (size_t i = first; i < last; i++) {
+            RowScan& scan = (*scans_)[i];
+            scan.max_delta_q = 0;
+            scan.thread = thread;
+            scan.first_tie = ties.size();
+
+            row_ties.clear();
+            scanner.ScanRow(cluster_matrix_, (*rows_)[i], &scan.max_delta_q,
+                    &row_ties);
+            ties.insert(ties.end(), row_ties.begin(), row_ties.end());
+            scan.tie_count = row_ties.size();
         }
+    }
 
-        // *******
-        // find join
-        // *******
+private:
+    SparseClusteringMatrix* cluster_matrix_;
+    const vector<t_vertex_id>* rows_;
+    vector<DeltaQScanner>* scanners_;
+    vector<RowScan>* scans_;
+    vector<vector<t_vertex_pair> >* ties_;
+};
+
+/*
+ * scans a block of the sampled rows of a join step per thread, every thread
+ * keeps its own maximum and ties
+ */
+class SampleScanTask : public ScanTask {
+public:
+    SampleScanTask(SparseClusteringMatrix* cluster_matrix,
+            const vector<t_vertex_id>* rows, vector<DeltaQScanner>* scanners,
+            vector<double>* max_delta_q, vector<vector<t_vertex_pair> >* ties) :
+            cluster_matrix_(cluster_matrix), rows_(rows), scanners_(scanners),
+            max_delta_q_(max_delta_q), ties_(ties) {}
+
+    void Run(int thread, int threads) {
+        size_t first = rows_->size() * thread / threads;
+        size_t last = rows_->size() * (thread + 1) / threads;
+        DeltaQScanner& scanner = (*scanners_)[thread];
+        double& max_delta_q = (*max_delta_q_)[thread];
+        vector<t_vertex_pair>& ties = (*ties_)[thread];
+
+        max_delta_q = -1;
+        ties.clear();
+        for (size_t i = first; i < last; i++)
+            scanner.ScanRow(cluster_matrix_, (*rows_)[i], &max_delta_q, &ties);
+    }
 
-        double max_delta_q = -1;
-        max_delta_q = -1;        
-        vector< pair<int, int> > bestJoins;  // Save equivalent joins
-        
-        for (int sample_num = 0; sample_num < max_sample; sample_num++) {
+private:
+    SparseClusteringMatrix* cluster_matrix_;
+    const vector<t_vertex_id>* rows_;
+    vector<DeltaQScanner>* scanners_;
+    vector<double>* max_delta_q_;
+    vector<vector<t_vertex_pair> >* ties_;
+};
+
+/*
+ * provides a scanner and a tie buffer for every thread
+ */
+void ModOptimizer::ProvideScanners(size_t threads) {
+    if (scanners_.size() < threads) {
+        scanners_.resize(threads);
+        scan_ties_.resize(threads);
+        scan_max_.resize(threads);
+    }
+}
 
-            int row_num;
-            if (max_sample == graph_->get_vertex_count() - 1 - step)
-                row_num = active_rows.Get(sample_num);
-            else
-                row_num = active_rows.GetRandomElement();
-             
-            t_row_value_map* sample_row = cluster_matrix.GetRow(row_num);
-
-            for (t_row_value_map::iterator entry = sample_row->begin(); entry != sample_row->end(); ++entry) {
-                int column_num = entry->first;
-                double value = entry->second;
-
-                if (column_num == row_num) continue;
-
-                double delta_q = 2 * (value - cluster_matrix.GetRowSum(row_num)*
-                        cluster_matrix.GetRowSum(column_num));
-
-                if (delta_q >= max_delta_q) {
-					// Found a better delta_q => delete previous results
-					if (delta_q > max_delta_q)
-						bestJoins.clear();
-					
-                    max_delta_q = delta_q;
-                    // Save the join to our collection
-                    if (cluster_matrix.GetRowEntries(row_num) >=
-                            cluster_matrix.GetRowEntries(column_num)) {
-                        bestJoins.push_back(make_pair(row_num, column_num));
-                    } else {
-                        bestJoins.push_back(make_pair(column_num, row_num));
-                    }
-                }
-            }
-        }
-        
-        // if there is no valid merge, stop merge process
-        // (can only occur for unconnected graph)
-        if (bestJoins.size() == 0) break;
-        
-        // Get random join from all found equivalent joins
-        int sel = rand() % bestJoins.size();
-        pair<int, int> join = bestJoins.at(sel);
-                
-        // *******
-        // execute join
-        // *******
-        cluster_matrix.JoinCluster(join.first, join.second);
-        active_rows.Remove(join.second);
-        joins[step] = join;
-        Q += max_delta_q;
+/*
+ * scans the rows with one thread per block of rows, the scans only read the
+ * cluster matrix
+ */
+void ModOptimizer::ScanRows(const vector<t_vertex_id>* rows,
+        vector<RowScan>* scans) {
+    scans->resize(rows->size());
+    size_t threads = std::min((size_t) threads_,
+            rows->size() / kMinRowsPerScanThread + 1);
+    ProvideScanners(threads);
+
+    RowScanTask task(workspace_.get_cluster_matrix(), rows, &scanners_, scans,
+            &scan_ties_);
+    scan_pool_.Run(&task, threads);
+}
 
-        if (Q > best_step_q) {
-            best_step_q = Q;
-            best_step = step;
+/*
+ * number of threads scanning a sample of the given size in a join step
+ */
+int ModOptimizer::GetSampleScanThreads(t_vertex_id sample_size) {
+    return std::max(1, std::min(threads_,
+            (int) (sample_size / kMinSampleRowsPerScanThread)));
+}
+
+/*
+ * Scans the sampled rows with one thread per block of rows. The blocks are
+ * merged in the order of the rows: the ties of every block with the highest
+ * maximum are appended. This gives the same maximum and the same ties in the
+ * same order as scanning the rows one after another, so the executed join
+ * does not depend on the number of threads.
+ */
+void ModOptimizer::ScanSample(int threads, double* max_delta_q,
+        vector<t_vertex_pair>* best_joins) {
+    ProvideScanners(threads);
+    SampleScanTask task(workspace_.get_cluster_matrix(), &sample_rows_,
+            &scanners_, &scan_max_, &scan_ties_);
+    scan_pool_.Run(&task, threads);
+
+    for (int t = 0; t < threads; t++) {
+        if (scan_max_[t] < *max_delta_q) continue;
+        if (scan_max_[t] > *max_delta_q) {
+            best_joins->clear();
+            *max_delta_q = scan_max_[t];
         }
+        best_joins->insert(best_joins->end(), scan_ties_[t].begin(),
+                scan_ties_[t].end());
     }
-
-    clusters_ = GetPartitionFromJoins(joins, best_step, NULL);
-    return best_step_q;
 }
 
-Partition* ModOptimizer::PerformJoinsRestart(Graph* graph, Partition* clusters,
-                                             int k_restart_) {
-    SparseClusteringMatrix cluster_matrix(graph, clusters);
-    ActiveRowSet active_rows(clusters);
+/*
+ * Multi-join rounds: every active row (in random order) proposes one of its
+ * joins with the highest positive delta Q, the proposals are sorted by delta
+ * Q and a greedy matching takes every join whose clusters are not joined yet
+ * in this round. The delta Q of joins of disjoint clusters add up, so all of
+ * them are executed. Stops when no join increases Q, which typically takes
+ * O(log n) rounds instead of n-1 steps. The rows changed by the joins of a
+ * round are rescanned by up to threads_ threads, the result does not depend
+ * on the number of threads.
+ */
+template <class StartPolicy>
+Partition* ModOptimizer::PerformMatchingJoins(StartPolicy* start,
+        double* best_q) {
+    start->Reset(&workspace_);
+    ActiveRowSet& active_rows = *workspace_.get_active_rows();
+    SparseClusteringMatrix& cluster_matrix = *workspace_.get_cluster_matrix();
+    vector<t_vertex_pair>& joins = *workspace_.get_joins();
+
+    double Q = start->GetStartQ(&cluster_matrix);
+    double start_q = Q;
+    t_vertex_id step = 0;
+    if (record_joins_) join_q_.resize(joins.size());
+
+    // proposals are kept until the row or one of its neighbors is joined
+    t_vertex_id vertex_count = graph_->get_vertex_count();
+    vector<JoinCandidate> proposals(vertex_count);
+    vector<bool> changed(vertex_count, true);
+    vector<bool> joined(vertex_count, false);
+    vector<t_vertex_id> rows;
+    vector<t_vertex_id> changed_rows;
+    vector<RowScan> scans;
+    vector<JoinCandidate> candidates;
+    UpdateMemory();
+
+    while (!CheckDeadline()) {
+        rows.resize(active_rows.GetActiveRowCount());
+        for (t_vertex_id i = 0; i < (t_vertex_id) rows.size(); i++)
+            rows[i] = active_rows.Get(i);
+        for (t_vertex_id i = rows.size() - 1; i > 0; i--)
+            std::swap(rows[i], rows[random_.Next() % (i + 1)]);
+
+        changed_rows.clear();
+        for (size_t i = 0; i < rows.size(); i++) {
+            if (!changed[rows[i]]) continue;
+            changed[rows[i]] = false;
+            changed_rows.push_back(rows[i]);
+        }
+        ScanRows(&changed_rows, &scans);
+        for (size_t i = 0; i < changed_rows.size(); i++) {
+            JoinCandidate& proposal = proposals[changed_rows[i]];
+            proposal.delta_q = scans[i].tie_count > 0 ? scans[i].max_delta_q : 0;
+            if (scans[i].tie_count > 0)
+                proposal.join = scan_ties_[scans[i].thread][scans[i].first_tie
+                        + random_.Next() % scans[i].tie_count];
+        }
+
+        candidates.clear();
+        for (size_t i = 0; i < rows.size(); i++)
+            if (proposals[rows[i]].delta_q > 0)
+                candidates.push_back(proposals[rows[i]]);
+        if (candidates.empty()) break;
+
+        std::stable_sort(candidates.begin(), candidates.end(), HasHigherDeltaQ);
+
+        t_vertex_id round_start = step;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            t_vertex_pair join = candidates[i].join;
+            if (joined[join.first] || joined[join.second]) continue;
+            joined[join.first] = true;
+            joined[join.second] = true;
+
+            cluster_matrix.JoinCluster(join.first, join.second);
+            active_rows.Remove(join.second);
+            Q += candidates[i].delta_q;
+            if (record_joins_) join_q_[step] = Q;
+            joins[step++] = join;
+        }
+        for (t_vertex_id i = round_start; i < step; i++) {
+            t_vertex_id cluster = joins[i].first;
+            joined[cluster] = false;
+            joined[joins[i].second] = false;
+            changed[cluster] = true;
+            BOOST_FOREACH(t_row_value_map_entry& entry,
+                    *cluster_matrix.GetRow(cluster))
+                changed[entry.first] = true;
+        }
+    }
 
-    uint dimension = clusters->get_partition_vector()->size();
-    vector<pair<int, int> > joins(dimension - 1);
+    joins_executed_ += step;
+    if (record_joins_) RecordJoins(start->GetPartition(), step, start_q);
+    UpdateMemory();
 
-    int best_step = -1;
-    double best_step_q = -1;
+    // every executed join increased Q, so all joins are used
+    *best_q = step > 0 ? Q : start->GetMinimumQ();
+    return GetPartitionFromJoins(&joins, step - 1, start->GetPartition());
+}
 
-    double modularity = 0; // not the actual start value of Q,
+/*
+ * The join engine: in every step the rows chosen by the sampling policy are
+ * scanned and one of the joins with the highest delta Q is executed at
+ * random. Returns the partition after the prefix of joins with the highest Q
+ * (stored in best_q).
+ */
+template <class StartPolicy, class SamplingPolicy>
+Partition* ModOptimizer::PerformJoinSteps(StartPolicy* start,
+        SamplingPolicy sampling, double* best_q) {
+    t_vertex_id dimension = start->Reset(&workspace_);
+    ActiveRowSet& active_rows = *workspace_.get_active_rows();
+    SparseClusteringMatrix& cluster_matrix = *workspace_.get_cluster_matrix();
+    vector<t_vertex_pair>& joins = *workspace_.get_joins();
+    vector<t_vertex_pair>& bestJoins = *workspace_.get_ties(); // Save equivalent joins
+    DeltaQScanner& scanner = *workspace_.get_scanner();
+
+    t_vertex_id best_step = -1;
+    double best_step_q = start->GetMinimumQ();
+    double Q = start->GetStartQ(&cluster_matrix);
+    double start_q = Q;
+    if (record_joins_) join_q_.resize(joins.size());
+    UpdateMemory();
 
     //**********
     // perform joins
     //**********
-    for (size_t step = 0; step < clusters->get_partition_vector()->size() - 1; step++) {
+    t_vertex_id step;
+    for (step = 0; step < dimension - 1; step++) {
+        // stop at the deadline, the best prefix of the joins is used
+        if ((step & 15) == 0 && CheckDeadline()) break;
 
-        int max_sample;
-        if ((uint)k_restart_ < (clusters->get_partition_vector()->size() - 1 - step)) {
-            max_sample = k_restart_;
-        } else {
-            max_sample = clusters->get_partition_vector()->size() - 1 - step;
-        }
+        t_vertex_id remaining = dimension - 1 - step;
+        t_vertex_id max_sample = sampling.GetSampleSize(remaining);
 
         // *******
         // find join
         // *******
         double max_delta_q = -1;
-		max_delta_q = -1;
-        vector< pair<int, int> > bestJoins;  // Save equivalent joins
-        
-        for (int sample_num = 0; sample_num < max_sample; sample_num++) {
-            int row_num;
-            if ((uint)max_sample == clusters->get_partition_vector()->size() - 1 - step)
+        bestJoins.clear();
+
+        t_vertex_id sample_num = 0;
+        bool in_order = SamplingPolicy::kRowsInOrder || max_sample == remaining;
+        int scan_threads = SamplingPolicy::kParallelScan ?
+                GetSampleScanThreads(max_sample) : 1;
+        if (scan_threads > 1) {
+            // the scans do not use random_, so the sample can be drawn first
+            sample_rows_.resize(max_sample);
+            for (t_vertex_id i = 0; i < max_sample; i++) {
+                if (in_order)
+                    sample_rows_[i] = active_rows.Get(i);
+                else
+                    sample_rows_[i] = active_rows.GetRandomElement(&random_);
+            }
+            ScanSample(scan_threads, &max_delta_q, &bestJoins);
+
+            sample_num = max_sample;
+            if (SamplingPolicy::kExtendWhileNegative && max_delta_q < 0 &&
+                    max_sample < remaining) {
+                max_sample++;
+                in_order = max_sample == remaining;
+            }
+        }
+
+        for (; sample_num < max_sample; sample_num++) {
+            t_vertex_id row_num;
+            if (in_order)
                 row_num = active_rows.Get(sample_num);
             else
-                row_num = active_rows.GetRandomElement();
-
-            t_row_value_map* sample_row = cluster_matrix.GetRow(row_num);
-
-            for (t_row_value_map::iterator entry = sample_row->begin();
-                    entry != sample_row->end(); ++entry) {
-                int column_num = entry->first;
-                double value = entry->second;
-
-                if (column_num == row_num) continue;
-
-                double delta_q = 2 * (value - cluster_matrix.GetRowSum(row_num)
-                        * cluster_matrix.GetRowSum(column_num));
-                        
-                if (delta_q >= max_delta_q) {
-					// Found a better delta_q => delete previous results
-					if (delta_q > max_delta_q)
-						bestJoins.clear();
-					
-                    max_delta_q = delta_q;
-                    // Save the join to our collection
-                    if (cluster_matrix.GetRowEntries(row_num) >=
-                            cluster_matrix.GetRowEntries(column_num)) {
-                        bestJoins.push_back(make_pair(row_num, column_num));
-                    } else {
-                        bestJoins.push_back(make_pair(column_num, row_num));
-                    }
-                }
-            }
-            if (sample_num == max_sample - 1 && max_delta_q < 0 &&
-                    (uint)max_sample < dimension - 1 - step)
+                row_num = active_rows.GetRandomElement(&random_);
+
+            scanner.ScanRow(&cluster_matrix, row_num, &max_delta_q, &bestJoins);
+
+            if (SamplingPolicy::kExtendWhileNegative &&
+                    sample_num == max_sample - 1 && max_delta_q < 0 &&
+                    max_sample < remaining) {
                 max_sample++;
+                in_order = max_sample == remaining;
+            }
         }
 
         // if there is no valid merge, stop merge process
         // (can only occur for unconnected graph)
         if (bestJoins.size() == 0) break;
-        
+
         // Get random join from all found equivalent joins
-        int sel = rand() % bestJoins.size();
-        pair<int, int> join = bestJoins.at(sel);
-        
+        int sel = random_.Next() % bestJoins.size();
+        t_vertex_pair join = bestJoins.at(sel);
+
         // *******
         // execute join
         // *******
         cluster_matrix.JoinCluster(join.first, join.second);
         active_rows.Remove(join.second);
         joins[step] = join;
-        modularity += max_delta_q;
+        Q += max_delta_q;
+        if (record_joins_) join_q_[step] = Q;
 
-        if (modularity > best_step_q) {
-            best_step_q = modularity;
+        if (Q > best_step_q) {
+            best_step_q = Q;
             best_step = step;
         }
     }
-    Partition* new_clusters = GetPartitionFromJoins(joins, best_step, clusters);
-    return new_clusters;
+    joins_executed_ += step;
+    if (record_joins_) RecordJoins(start->GetPartition(), step, start_q);
+    UpdateMemory();
+
+    *best_q = best_step_q;
+    return GetPartitionFromJoins(&joins, best_step, start->GetPartition());
 }
 
 Partition* ModOptimizer::GetPartitionFromJoins(
-        vector<pair<int, int> > joins,
-        const int &bestStep,
+        vector<t_vertex_pair>* joins,
+        const t_vertex_id &bestStep,
         Partition* partial_partition) {
     
     Partition* result_partition = new Partition();
     if (partial_partition == NULL) { // create new singleton partition
         // Initialize clusters
-        for (int i = 0; i < graph_->get_vertex_count(); i++) {
-            list<int>* vlist = new list<int>();
+        for (t_vertex_id i = 0; i < graph_->get_vertex_count(); i++) {
+            t_id_list* vlist = new t_id_list();
             vlist->push_back(i);
             result_partition->get_partition_vector()->push_back(vlist);
         }
     } else { // rearrange input partition
         // we need to create the complete list
-        for (int i = 0; i < graph_->get_vertex_count(); i++) {
-            list<int>* vlist = new list<int>();
+        for (t_vertex_id i = 0; i < graph_->get_vertex_count(); i++) {
+            t_id_list* vlist = new t_id_list();
             result_partition->get_partition_vector()->push_back(vlist);
         }
 
         for (size_t i = 0; i < partial_partition->get_partition_vector()->size(); i++) {
             // the first element of the list determines where to put the list
-            int pos = *(partial_partition->get_partition_vector()->at(i)->begin());
-            BOOST_FOREACH(int vertex,
+            t_vertex_id pos = *(partial_partition->get_partition_vector()->at(i)->begin());
+            BOOST_FOREACH(t_vertex_id vertex,
                     *(partial_partition->get_partition_vector()->at(i))) {
                 result_partition->get_partition_vector()->at(pos)->
                         push_back(vertex);
@@ -385,15 +1236,16 @@ Partition* ModOptimizer::GetPartitionFromJoins(
     }
 
     //join clusters according to join list
-    for (int step = 0; step <= bestStep; step++) {
-        list<int>* list1 =
-                result_partition->get_partition_vector()->at(joins[step].first);
-        list<int>* list2 =
-                result_partition->get_partition_vector()->at(joins[step].second);
+    for (t_vertex_id step = 0; step <= bestStep; step++) {
+        t_vertex_pair& join = (*joins)[step];
+        t_id_list* list1 =
+                result_partition->get_partition_vector()->at(join.first);
+        t_id_list* list2 =
+                result_partition->get_partition_vector()->at(join.second);
 
         list1->splice(list1->end(), *list2);
-        delete result_partition->get_partition_vector()->at(joins[step].second);
-        result_partition->get_partition_vector()->at(joins[step].second) = NULL;
+        delete list2;
+        result_partition->get_partition_vector()->at(join.second) = NULL;
     }
 
     result_partition->RemoveEmptyEntries();
@@ -401,26 +1253,26 @@ Partition* ModOptimizer::GetPartitionFromJoins(
 }
 
 Partition* ModOptimizer::RefineCluster(Graph* graph, Partition* clusters) {
-    typedef boost::unordered_map<int, int> t_id_id_mapping;
-
     clusters->RemoveEmptyEntries();
 
-    int cluster_count = clusters->get_partition_vector()->size();
-    vector<int> clusterdegree(cluster_count); // sum of degrees of all vertices of a cluster
-    vector<int> clustermap(graph->get_vertex_count()); // maps vertex_id -> cluster_id
-
-    vector<t_id_id_mapping> links(graph->get_vertex_count());
-    //for (int i=0; i<)
+    t_vertex_id cluster_count = clusters->get_partition_vector()->size();
+    if (release_memory_) workspace_.ReleaseJoinPhase();
+    workspace_.ResetRefinement(graph, cluster_count);
+    // sum of degrees of all vertices of a cluster
+    vector<t_edge_count>& clusterdegree = *workspace_.get_clusterdegree();
+    // maps vertex_id -> cluster_id
+    vector<t_vertex_id>& clustermap = *workspace_.get_clustermap();
+    vector<t_id_id_mapping>& links = *workspace_.get_links();
 
     /*
      *   Create and fill data structure
      */
-    for (int i = 0; i < cluster_count; i++) {
-        list<int>* cluster = clusters->get_partition_vector()->at(i);
+    for (t_vertex_id i = 0; i < cluster_count; i++) {
+        t_id_list* cluster = clusters->get_partition_vector()->at(i);
 
-        int cdegree = 0;
-        BOOST_FOREACH(int vertexid, *cluster) {
-            cdegree += graph->GetNeighbors(vertexid)->size();
+        t_edge_count cdegree = 0;
+        BOOST_FOREACH(t_vertex_id vertexid, *cluster) {
+            cdegree += graph->GetDegree(vertexid);
             clustermap[vertexid] = i;
         }
         clusterdegree[i] = cdegree;
@@ -429,15 +1281,16 @@ Partition* ModOptimizer::RefineCluster(Graph* graph, Partition* clusters) {
 
     double edgeCount = 0;
 
-    for (int i = 0; i < graph->get_vertex_count(); i++) {
-        vector<int>* neighbors = graph->GetNeighbors(i);
+    vector<t_vertex_id> buffer;
+    for (t_vertex_id i = 0; i < graph->get_vertex_count(); i++) {
+        vector<t_vertex_id>* neighbors = graph->GetNeighbors(i, &buffer);
         for (size_t j = 0; j < neighbors->size(); j++) {
-            int neighbor_id = neighbors->at(j);
+            t_vertex_id neighbor_id = neighbors->at(j);
             if (i == neighbor_id) continue;
 
-            int neighborcluster = clustermap[neighbor_id];
+            t_vertex_id neighborcluster = clustermap[neighbor_id];
 
-            int newvalue = 1;
+            t_vertex_id newvalue = 1;
             if (links[i].find(neighborcluster) != links[i].end()) {
                 newvalue += links[i][neighborcluster];
             }
@@ -447,40 +1300,35 @@ Partition* ModOptimizer::RefineCluster(Graph* graph, Partition* clusters) {
         }
     }
     edgeCount /= 2; // we counted all edges twice
+    UpdateMemory();
 
     /*
      *   Calculate and execute vertex moves
      */
     bool improvement_found = true;
-    int movecount = 0;
+    t_edge_count movecount = 0;
     double sum_delta_q = 0.0;
     while (improvement_found) {
         improvement_found = false;
-        for (int vertex_id = 0; vertex_id < graph->get_vertex_count(); vertex_id++) {
+        for (t_vertex_id vertex_id = 0; vertex_id < graph->get_vertex_count(); vertex_id++) {
 
-            int best_move_cluster = -1;
+            t_vertex_id best_move_cluster = -1;
             double bestDeltaQ = 0;
 
-            int current_cluster_id = clustermap[vertex_id];
+            t_vertex_id current_cluster_id = clustermap[vertex_id];
 
             // for all adjacent clusters of the cluster of vertexid
             for (t_id_id_mapping::iterator iter = links[vertex_id].begin();
                     iter != links[vertex_id].end(); ++iter) {
-                int cluster_id = iter->first;
+                t_vertex_id cluster_id = iter->first;
 
                 if (current_cluster_id == cluster_id) continue;
 
-                double term1 = (double) (links[vertex_id][cluster_id] -
-                        links[vertex_id][current_cluster_id]) / edgeCount;
-                double term2 = clusterdegree[cluster_id] -
-                        clusterdegree[current_cluster_id];
-                term2 += graph->GetNeighbors(vertex_id)->size();
-                term2 *= graph->GetNeighbors(vertex_id)->size();
-                term2 /= 2.0;
-                term2 /= edgeCount;
-                term2 /= edgeCount;
-
-                double deltaQ = term1 - term2;
+                double deltaQ = GetMoveDeltaQ(links[vertex_id][cluster_id],
+                        links[vertex_id][current_cluster_id],
+                        clusterdegree[cluster_id],
+                        clusterdegree[current_cluster_id],
+                        graph->GetDegree(vertex_id), edgeCount);
 
                 if (deltaQ > bestDeltaQ) {
                     bestDeltaQ = deltaQ;
@@ -491,13 +1339,13 @@ Partition* ModOptimizer::RefineCluster(Graph* graph, Partition* clusters) {
             // move vertex
             if (bestDeltaQ > 0) {
                 sum_delta_q += bestDeltaQ;
-                clusterdegree[current_cluster_id] -=
-                        graph->GetNeighbors(vertex_id)->size();
-                clusterdegree[best_move_cluster] +=
-                        graph->GetNeighbors(vertex_id)->size();
+                vector<t_vertex_id>* neighbors =
+                        graph->GetNeighbors(vertex_id, &buffer);
+                clusterdegree[current_cluster_id] -= neighbors->size();
+                clusterdegree[best_move_cluster] += neighbors->size();
 
-                for (size_t i = 0; i < graph->GetNeighbors(vertex_id)->size(); i++) {
-                    int neighborid = graph->GetNeighbors(vertex_id)->at(i);
+                for (size_t i = 0; i < neighbors->size(); i++) {
+                    t_vertex_id neighborid = neighbors->at(i);
 
                     links[neighborid][current_cluster_id]--;
                     if (links[neighborid].find(best_move_cluster) !=
@@ -512,49 +1360,54 @@ Partition* ModOptimizer::RefineCluster(Graph* graph, Partition* clusters) {
                 movecount++;
             }
         }
+
+        // after the deadline only one pass over all vertices is made
+        if (improvement_found && CheckDeadline()) break;
     }
 
     Partition* resultclusters = new Partition(cluster_count);
-    for (int i = 0; i < graph->get_vertex_count(); i++) {
-        int x = clustermap[i];
-        list<int>* cluster = resultclusters->get_partition_vector()->at(x);
+    for (t_vertex_id i = 0; i < graph->get_vertex_count(); i++) {
+        t_vertex_id x = clustermap[i];
+        t_id_list* cluster = resultclusters->get_partition_vector()->at(x);
         cluster->push_back(i);
     }
     
     resultclusters->RemoveEmptyEntries();
+    if (release_memory_) workspace_.ReleaseRefinement();
 
     return resultclusters;
 }
 
 double ModOptimizer::GetModularityFromClustering(Graph* graph,
         Partition* clusters) {
-    int cluster_count = clusters->get_partition_vector()->size();
+    t_vertex_id cluster_count = clusters->get_partition_vector()->size();
 
-    vector<int> clustermap (graph->get_vertex_count()); // maps vertex_id -> cluster_id
-    for (int i = 0; i < cluster_count; i++) {
-        list<int>* cluster = clusters->get_partition_vector()->at(i);
-        int csize = 0;
-        BOOST_FOREACH (int vertex_id, *cluster) {    
+    vector<t_vertex_id> clustermap (graph->get_vertex_count()); // maps vertex_id -> cluster_id
+    for (t_vertex_id i = 0; i < cluster_count; i++) {
+        t_id_list* cluster = clusters->get_partition_vector()->at(i);
+        t_vertex_id csize = 0;
+        BOOST_FOREACH (t_vertex_id vertex_id, *cluster) {    
             clustermap[vertex_id] = i;
             csize++;
         }
     }
 
-    typedef boost::unordered_map<int,double> t_sparse_row_vector;
+    typedef boost::unordered_map<t_vertex_id,double> t_sparse_row_vector;
     typedef vector<t_sparse_row_vector*> t_sparse_matrix;
 
     t_sparse_matrix e;
-    for (int i = 0; i < cluster_count; i++)
+    for (t_vertex_id i = 0; i < cluster_count; i++)
         e.push_back(new t_sparse_row_vector());
 
-    int edge_count = 0; // will be 2*|E|
-    for (int i = 0; i < graph->get_vertex_count(); i++) {
-        vector<int>* neighbors = graph->GetNeighbors(i);
+    t_edge_count edge_count = 0; // will be 2*|E|
+    vector<t_vertex_id> buffer;
+    for (t_vertex_id i = 0; i < graph->get_vertex_count(); i++) {
+        vector<t_vertex_id>* neighbors = graph->GetNeighbors(i, &buffer);
         for (size_t j = 0; j < neighbors->size(); j++) {
             if (i == neighbors->at(j)) continue; // disregard loops
 
-            int from = clustermap[i];
-            int to = clustermap[neighbors->at(j)];
+            t_vertex_id from = clustermap[i];
+            t_vertex_id to = clustermap[neighbors->at(j)];
 	    if (e[from]->find(to) != e[from]->end())	            
 		e[from]->at(to) += 1.0;
 	    else
@@ -565,19 +1418,19 @@ double ModOptimizer::GetModularityFromClustering(Graph* graph,
     }
 
     vector<double> a(cluster_count);
-    for (int i = 0; i < cluster_count; i++) {
+    for (t_vertex_id i = 0; i < cluster_count; i++) {
         a[i] = 0.0;
 
     	for (t_sparse_row_vector::iterator iter = e[i]->begin();
                 iter != e[i]->end(); ++iter) {    
-            int column = iter->first;
+            t_vertex_id column = iter->first;
             e[i]->at(column) /= (double) edge_count;
             a[i] += e[i]->at(column);
         }
     }
 
     double Q = 0.0;
-    for (int i = 0; i < cluster_count; i++)
+    for (t_vertex_id i = 0; i < cluster_count; i++)
 	if (e[i]->find(i) != e[i]->end())
         	Q += e[i]->at(i) - a[i] * a[i];
 	else
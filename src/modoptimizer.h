@@ -9,9 +9,17 @@
 
 #include <vector>
 #include <list>
+#include <string>
 
 #include <boost/unordered_map.hpp>
 
+#include "indextypes.h"
+#include "randomsource.h"
+#include "clusteringworkspace.h"
+#include "perfcounters.h"
+#include "memoryaccount.h"
+#include "scanthreadpool.h"
+
 
 #ifndef MODOPTIMIZER_H_
 #define MODOPTIMIZER_H_
@@ -20,8 +28,9 @@ using namespace std;
 
 class Partition;
 class Graph;
-class ActiveRowSet;
-class SparseClusteringMatrix;
+class Dendrogram;
+struct CGGCCheckpoint;
+struct RowScan;
 
 class ModOptimizer {
 public:
@@ -29,28 +38,119 @@ public:
     virtual ~ModOptimizer();
 
     Partition* GetClusters();
+    void SetSeed(unsigned int seed);
+    void SetInitialPartition(Partition* partition);
+    void SetDeadline(double deadline);
+    void SetThreads(int threads);
+    void SetLocalMovingEnsemble(bool local_moving);
+    void SetPendantFolding(bool fold);
+    void SetMultiJoin(bool multi_join);
+    void SetDendrogramRecording(bool record);
+    Dendrogram* GetDendrogram();
+    void SetCheckpoint(std::string filename, bool resume);
+    void SetEnsembleKey(std::string key);
+    void SetEnsembleCache(std::string filename);
+    bool EnablePerfCounters();
+    PerfCounters* GetPerfCounters();
+    vector<PhaseCounters>* GetPhaseCounters();
+    vector<string>* GetTruncatedPhases();
+    bool SetMemoryLimit(size_t bytes, MemoryEstimate* estimate);
+    bool IsMemoryLimitExceeded();
+    vector<PhaseMemory>* GetPhaseMemory();
 
     void ClusterRG(int sample_size, int runs);
+    void ClusterLocalMoving(int runs);
     void ClusterCGGC(int ensemble_size, int sample_size_restart,
         bool iterative);
+    void ClusterWarmStart(Partition* partition, int sample_size_restart);
+    void UpdateClustering(Partition* clusters, list<t_vertex_pair>* insertions,
+        list<t_vertex_pair>* deletions, int sample_size);
     double GetModularityFromClustering(Graph* graph, Partition* clusters);
 
 private:
     Graph* graph_;
-    ActiveRowSet* active_rows_;
-    SparseClusteringMatrix* cluster_matrix_;
     Partition* clusters_;
+    RandomSource random_;
+    Partition* initial_partition_;
+    double deadline_;
+    const char* phase_;               // phase reported when cut short
+    vector<string> truncated_phases_;
+    ClusteringWorkspace workspace_;   // reused by all join and refine steps
+    bool local_moving_ensemble_;      // ensemble members by local moving
+    Partition* folded_partition_;     // start of RG with folded pendants
+    bool multi_join_;                 // RG joins matchings of clusters
+    int threads_;                     // threads scanning rows
+    ScanThreadPool scan_pool_;
+    vector<DeltaQScanner> scanners_;  // one per thread scanning rows
+    vector<vector<t_vertex_pair> > scan_ties_;  // ties found per thread
+    vector<double> scan_max_;         // best delta Q found per thread
+    vector<t_vertex_id> sample_rows_; // rows sampled in a join step
+    bool record_dendrogram_;          // keep the joins of the final RG step
+    bool record_joins_;               // the current join phase is recorded
+    vector<double> join_q_;           // Q after each join if recorded
+    Dendrogram* run_dendrogram_;      // joins of the last recorded phase
+    Dendrogram* dendrogram_;          // joins leading to the result
+    std::string checkpoint_filename_; // CGGC state after each phase step
+    bool resume_;                     // CGGC continues from the checkpoint
+    std::string ensemble_cache_;      // prefix of the cached core groups
+    std::string ensemble_key_;        // ensemble options and seed of the run
+    PerfCounters* perf_counters_;     // NULL unless enabled
+    vector<PhaseCounters> phase_counters_;
+    uint64_t phase_start_values_[kPerfCounterCount];
+    double phase_start_time_;
+    int64_t joins_executed_;          // joins of all RG steps so far
+    int64_t phase_start_joins_;
+    size_t memory_limit_;             // bytes, 0 if there is no limit
+    bool release_memory_;             // free the phase structures after use
+    bool memory_exceeded_;            // the limit was hit, phases stop early
+    size_t held_partition_bytes_;     // partitions held by CGGC
+    vector<PhaseMemory> phase_memory_;
+
+    bool CheckDeadline();
+    void EnterPhase(const char* phase);
+    void UpdateMemory();
+    void SetHeldPartitions(Partition* partition1, Partition* partition2);
+    Partition* BuildEnsembleMember();
+    Partition* ReadCheckpoint(int ensemble_size, bool iterative,
+        CGGCCheckpoint* checkpoint);
+    void WriteCheckpoint(int ensemble_size, bool iterative, int stage,
+        int progress, double cur_q, double last_q, Partition* clusters);
+    Partition* ReadEnsembleCache(int ensemble_size, bool iterative,
+        CGGCCheckpoint* checkpoint);
+    void WriteEnsembleCache(int ensemble_size, int stage, int progress,
+        double cur_q, double last_q, Partition* clusters);
+    void FillCheckpoint(int ensemble_size, bool iterative, int stage,
+        int progress, double cur_q, double last_q, CGGCCheckpoint* checkpoint);
+    void KeepRunDendrogram(bool keep);
+    void RecordJoins(Partition* start_partition, t_vertex_id step_count,
+        double start_q);
+    void KeepBestMember(Partition* member, Partition** best_member,
+        double* best_member_q);
 
     Partition* CompareClusters(Graph* graph, Partition* partition1,
         Partition* partition2);
     double PerformJoins(int sample_size);
     Partition* PerformJoinsRestart(Graph* graph, Partition* partition,
         int sample_size_restart);
+    template <class StartPolicy>
+    Partition* PerformSampledJoins(StartPolicy* start, int sample_size,
+        t_vertex_id dimension, double* best_q);
+    void ProvideScanners(size_t threads);
+    void ScanRows(const vector<t_vertex_id>* rows,
+        vector<RowScan>* scans);
+    int GetSampleScanThreads(t_vertex_id sample_size);
+    void ScanSample(int threads, double* max_delta_q,
+        vector<t_vertex_pair>* best_joins);
+    template <class StartPolicy>
+    Partition* PerformMatchingJoins(StartPolicy* start, double* best_q);
+    template <class StartPolicy, class SamplingPolicy>
+    Partition* PerformJoinSteps(StartPolicy* start, SamplingPolicy sampling,
+        double* best_q);
     Partition* RefineCluster(Graph* graph, Partition* clusters);
-    Partition* GetPartitionFromJoins(vector<pair<int, int> > joins,
-        const int &best_step,  Partition* partition);
-    vector<int>* GetMembershipFromPartition(Partition* partition,
-        int vertex_count);
+    Partition* GetPartitionFromJoins(vector<t_vertex_pair>* joins,
+        const t_vertex_id &best_step,  Partition* partition);
+    vector<t_vertex_id>* GetMembershipFromPartition(Partition* partition,
+        t_vertex_id vertex_count);
 };
 
 #endif /* MODOPTIMIZER_H_ */
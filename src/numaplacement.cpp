@@ -0,0 +1,151 @@
+//============================================================================
+// Name        : NumaPlacement.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : NUMA nodes of the machine, pins threads to the CPUs of a node
+//               and interleaves the memory of a thread over all nodes
+//============================================================================
+
+
+#include "numaplacement.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+static const char* kNodeDirectory = "/sys/devices/system/node/";
+
+NumaPlacement::NumaPlacement() {
+}
+
+NumaPlacement::~NumaPlacement() {
+}
+
+/*
+ * reads a list like "0-3,8,10-11" as written by the kernel for CPUs and
+ * nodes, returns false if the file can not be read
+ */
+bool NumaPlacement::ReadList(std::string filename, std::vector<int>* ids) {
+    std::ifstream infile(filename.data());
+    std::string line;
+    if (!infile || !getline(infile, line))
+        return false;
+
+    ids->clear();
+    std::istringstream ranges(line);
+    std::string range;
+    while (getline(ranges, range, ',')) {
+        int first, last;
+        char dash;
+        std::istringstream bounds(range);
+        if (!(bounds >> first)) continue;
+        if (!(bounds >> dash >> last) || dash != '-') last = first;
+        for (int id = first; id <= last; id++)
+            ids->push_back(id);
+    }
+    return true;
+}
+
+/*
+ * reads the nodes with CPUs and their CPUs, returns true if there are at
+ * least two of them
+ */
+bool NumaPlacement::Detect() {
+    nodes_.clear();
+    cpus_.clear();
+    memory_nodes_.clear();
+
+    std::vector<int> online;
+    if (!ReadList(std::string(kNodeDirectory) + "online", &online)) {
+        error_ = "no NUMA information in " + std::string(kNodeDirectory);
+        return false;
+    }
+    if (!ReadList(std::string(kNodeDirectory) + "has_memory", &memory_nodes_))
+        memory_nodes_ = online;
+
+    for (size_t i = 0; i < online.size(); i++) {
+        std::ostringstream filename;
+        filename << kNodeDirectory << "node" << online[i] << "/cpulist";
+        std::vector<int> cpus;
+        if (!ReadList(filename.str(), &cpus) || cpus.empty()) continue;
+        nodes_.push_back(online[i]);
+        cpus_.push_back(cpus);
+    }
+
+    if (nodes_.size() < 2) {
+        error_ = "single NUMA node";
+        return false;
+    }
+    return true;
+}
+
+/*
+ * number of nodes with CPUs, 0 before Detect
+ */
+int NumaPlacement::get_node_count() {
+    return nodes_.size();
+}
+
+std::string NumaPlacement::get_error() {
+    return error_;
+}
+
+/*
+ * restricts the calling thread to the CPUs of the node with the given index
+ * (modulo the number of nodes). Threads it starts later inherit this. On
+ * failure errno is set.
+ */
+bool NumaPlacement::PinThread(int node) {
+    if (nodes_.size() < 2)
+        return false;
+#ifdef __linux__
+    std::vector<int>& cpus = cpus_[node % cpus_.size()];
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (size_t i = 0; i < cpus.size(); i++)
+        if (cpus[i] < CPU_SETSIZE)
+            CPU_SET(cpus[i], &cpu_set);
+    return sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0;
+#else
+    return false;
+#endif
+}
+
+/*
+ * With interleave, the pages the calling thread (and the threads it starts
+ * later) allocates from now on are spread round robin over all nodes with
+ * memory, otherwise they are placed on the node of the thread again. On
+ * failure errno is set.
+ */
+bool NumaPlacement::InterleaveThreadMemory(bool interleave) {
+    if (nodes_.size() < 2)
+        return false;
+#ifdef __linux__
+    long result;
+    if (interleave) {
+        int max_node = 0;
+        for (size_t i = 0; i < memory_nodes_.size(); i++)
+            if (memory_nodes_[i] > max_node) max_node = memory_nodes_[i];
+        const size_t word_bits = 8 * sizeof(unsigned long);
+        std::vector<unsigned long> mask(max_node / word_bits + 1, 0);
+        for (size_t i = 0; i < memory_nodes_.size(); i++)
+            mask[memory_nodes_[i] / word_bits] |=
+                    1UL << (memory_nodes_[i] % word_bits);
+        // the kernel expects the number of bits plus one
+        result = syscall(__NR_set_mempolicy, MPOL_INTERLEAVE, &mask[0],
+                mask.size() * word_bits + 1);
+    } else
+        result = syscall(__NR_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+    return result == 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,47 @@
+//============================================================================
+// Name        : NumaPlacement.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : NUMA nodes of the machine, pins threads to the CPUs of a node
+//               and interleaves the memory of a thread over all nodes
+//============================================================================
+
+
+#ifndef NUMAPLACEMENT_H_
+#define NUMAPLACEMENT_H_
+
+#include <string>
+#include <vector>
+
+/*
+ * Reads the nodes from /sys/devices/system/node. On machines with a single
+ * node (or without the information) Detect returns false (see get_error)
+ * and the other methods do nothing.
+ *
+ * Linux places a page on the node of the thread that first writes it, so the
+ * structures of a run are local if its threads are pinned to one node.
+ * Memory shared by threads on all nodes is better interleaved.
+ */
+class NumaPlacement {
+public:
+    NumaPlacement();
+    virtual ~NumaPlacement();
+
+    bool Detect();
+    int get_node_count();
+    std::string get_error();
+
+    bool PinThread(int node);
+    bool InterleaveThreadMemory(bool interleave);
+
+private:
+    std::vector<int> nodes_;                 // ids of the nodes with CPUs
+    std::vector<std::vector<int> > cpus_;    // CPUs per entry of nodes_
+    std::vector<int> memory_nodes_;          // ids of the nodes with memory
+    std::string error_;
+
+    static bool ReadList(std::string filename, std::vector<int>* ids);
+};
+
+#endif /* NUMAPLACEMENT_H_ */
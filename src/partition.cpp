@@ -13,10 +13,10 @@
 #include <boost/foreach.hpp>
 
 
-Partition::Partition(int size) {
+Partition::Partition(t_vertex_id size) {
     partition_vector_.reserve(size);
-    for (int i = 0; i < size; i++)
-        partition_vector_.push_back(new list<int>());
+    for (t_vertex_id i = 0; i < size; i++)
+        partition_vector_.push_back(new t_id_list());
 }
 
 Partition::~Partition() {
@@ -27,8 +27,8 @@ Partition::~Partition() {
 void Partition::print() {
 	std::ostream file(std::cout.rdbuf());
     for (size_t i = 0; i<partition_vector_.size(); i++) {
-        list<int>* cluster = partition_vector_[i];
-        BOOST_FOREACH(int vertexid, *cluster) {   
+        t_id_list* cluster = partition_vector_[i];
+        BOOST_FOREACH(t_vertex_id vertexid, *cluster) {   
             file << vertexid << " ";
         }
         file << std::endl;
@@ -37,19 +37,34 @@ void Partition::print() {
 
 void Partition::print(std::ostream file) {
     for (size_t i = 0; i<partition_vector_.size(); i++) {
-        list<int>* cluster = partition_vector_[i];
-        BOOST_FOREACH(int vertexid, *cluster) {   
+        t_id_list* cluster = partition_vector_[i];
+        BOOST_FOREACH(t_vertex_id vertexid, *cluster) {   
             file << vertexid << " ";
         }
         file << std::endl;
     }
 }
 
+/*
+ * returns a deep copy, the default copy would share the cluster lists
+ */
+Partition* Partition::Copy() {
+    Partition* result = new Partition();
+    result->partition_vector_.reserve(partition_vector_.size());
+    for (size_t i = 0; i < partition_vector_.size(); i++) {
+        if (partition_vector_[i] == NULL)
+            result->partition_vector_.push_back(NULL);
+        else
+            result->partition_vector_.push_back(new t_id_list(*partition_vector_[i]));
+    }
+    return result;
+}
+
 t_partition* Partition::get_partition_vector() {
     return &partition_vector_;
 }
 
-bool IsEmpty(list<int>* list) {
+bool IsEmpty(t_id_list* list) {
     bool result = (list == NULL || list->begin() == list->end());
     if (result)
         delete list;
@@ -66,3 +81,25 @@ void Partition::RemoveEmptyEntries() {
             this->partition_vector_.end(), IsEmpty),
             this->partition_vector_.end());
 }
+
+/*
+ * approximate bytes of the partition, a list node and its heap header per
+ * vertex and a list per cluster
+ */
+size_t Partition::GetMemoryBytes() {
+    size_t bytes = partition_vector_.capacity() * sizeof(t_id_list*);
+    for (size_t i = 0; i < partition_vector_.size(); i++) {
+        if (partition_vector_[i] == NULL) continue;
+        bytes += sizeof(t_id_list) + 16 + partition_vector_[i]->size() * 32;
+    }
+    return bytes;
+}
+
+/*
+ * bytes of a partition of the given number of vertices with clusters of
+ * four vertices on average
+ */
+size_t Partition::EstimateBytes(t_vertex_id vertex_count) {
+    return (size_t) vertex_count * 32 + (size_t) vertex_count / 4 *
+            (sizeof(t_id_list*) + sizeof(t_id_list) + 16);
+}
@@ -14,17 +14,22 @@
 #include <list>
 #include <iostream>
 
+#include "indextypes.h"
+
 using namespace std;
 
-typedef list<int> t_id_list;
+typedef list<t_vertex_id> t_id_list;
 typedef vector<t_id_list*> t_partition;
 
 class Partition {
 public:
-    Partition(int size = 0);
+    Partition(t_vertex_id size = 0);
     virtual ~Partition();
 
+    Partition* Copy();
     void RemoveEmptyEntries();
+    size_t GetMemoryBytes();
+    static size_t EstimateBytes(t_vertex_id vertex_count);
     void print();
     void print(ostream file);
     
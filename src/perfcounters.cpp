@@ -0,0 +1,123 @@
+//============================================================================
+// Name        : PerfCounters.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : hardware performance counters (perf_event_open) of the
+//               calling thread and the threads it starts, for the phases of
+//               a clustering run
+//============================================================================
+
+
+#include "perfcounters.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+PerfCounters::PerfCounters() {
+    for (int i = 0; i < kPerfCounterCount; i++)
+        fds_[i] = -1;
+}
+
+PerfCounters::~PerfCounters() {
+    for (int i = 0; i < kPerfCounterCount; i++)
+        if (fds_[i] != -1) close(fds_[i]);
+}
+
+#ifdef __linux__
+/*
+ * type and config of the perf events in the order of PerfCounter
+ */
+static const uint32_t kEventTypes[kPerfCounterCount] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+};
+static const uint64_t kEventConfigs[kPerfCounterCount] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+};
+#endif
+
+/*
+ * opens the counters for the calling thread and all threads it starts later
+ * (user space only, allowed with perf_event_paranoid <= 2). Counters the CPU
+ * or the virtual machine does not offer stay unavailable, returns false if
+ * none could be opened (see get_error).
+ */
+bool PerfCounters::Open() {
+#ifdef __linux__
+    bool opened = false;
+    for (int i = 0; i < kPerfCounterCount; i++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = kEventTypes[i];
+        attr.config = kEventConfigs[i];
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fds_[i] == -1) {
+            if (error_.empty()) error_ = strerror(errno);
+        } else
+            opened = true;
+    }
+    return opened;
+#else
+    error_ = "not supported on this platform";
+    return false;
+#endif
+}
+
+bool PerfCounters::IsAvailable(PerfCounter counter) {
+    return fds_[counter] != -1;
+}
+
+bool PerfCounters::IsAnyAvailable() {
+    for (int i = 0; i < kPerfCounterCount; i++)
+        if (fds_[i] != -1) return true;
+    return false;
+}
+
+/*
+ * current values of all counters, scaled up if the kernel had to multiplex
+ * them, 0 for unavailable counters
+ */
+void PerfCounters::Read(uint64_t* values) {
+    for (int i = 0; i < kPerfCounterCount; i++) {
+        values[i] = 0;
+        uint64_t data[3]; // value, time enabled, time running
+        if (fds_[i] == -1 || read(fds_[i], data, sizeof(data)) !=
+                (ssize_t) sizeof(data))
+            continue;
+
+        if (data[2] > 0 && data[2] < data[1])
+            values[i] = (uint64_t) ((double) data[0] * data[1] / data[2]);
+        else
+            values[i] = data[0];
+    }
+}
+
+std::string PerfCounters::get_error() {
+    return error_;
+}
+
+const char* PerfCounters::GetName(PerfCounter counter) {
+    static const char* names[kPerfCounterCount] = {
+        "cycles", "instructions", "cache-misses", "branch-misses", "tlb-misses"
+    };
+    return names[counter];
+}
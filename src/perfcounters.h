@@ -0,0 +1,58 @@
+//============================================================================
+// Name        : PerfCounters.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : hardware performance counters (perf_event_open) of the
+//               calling thread and the threads it starts, for the phases of
+//               a clustering run
+//============================================================================
+
+
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+#include <stdint.h>
+#include <string>
+
+enum PerfCounter {
+    kCycles = 0,
+    kInstructions,
+    kCacheMisses,
+    kBranchMisses,
+    kTlbMisses,
+    kPerfCounterCount
+};
+
+/*
+ * counter values and work done in one phase, summed over all its periods
+ */
+struct PhaseCounters {
+    std::string phase;
+    double time;
+    int64_t joins;
+    uint64_t values[kPerfCounterCount];
+};
+
+class PerfCounters {
+public:
+    PerfCounters();
+    virtual ~PerfCounters();
+
+    bool Open();
+    bool IsAvailable(PerfCounter counter);
+    bool IsAnyAvailable();
+    void Read(uint64_t* values);
+    std::string get_error();
+
+    static const char* GetName(PerfCounter counter);
+
+private:
+    int fds_[kPerfCounterCount];
+    std::string error_;
+
+    PerfCounters(const PerfCounters&);
+    PerfCounters& operator=(const PerfCounters&);
+};
+
+#endif /* PERFCOUNTERS_H_ */
@@ -0,0 +1,60 @@
+//============================================================================
+// Name        : RandomSource.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : random number generator owned by a single clusterer, yields
+//               the same sequence as srand()/rand() but keeps its own state
+//               so that several clusterers can run in parallel
+//============================================================================
+
+
+#include "randomsource.h"
+
+#include <string.h>
+
+RandomSource::RandomSource(unsigned int seed) {
+    Seed(seed);
+}
+
+/*
+ * a 128 byte state selects the same generator type rand() uses, so a given
+ * seed reproduces the results of earlier versions seeded with srand()
+ */
+void RandomSource::Seed(unsigned int seed) {
+    memset(&data_, 0, sizeof(data_));
+    initstate_r(seed, state_, RANDOM_STATE_SIZE, &data_);
+}
+
+/*
+ * returns a random number between 0 and RAND_MAX
+ */
+int RandomSource::Next() {
+    int32_t result;
+    random_r(&data_, &result);
+    return result;
+}
+
+void RandomSource::GetState(RandomSourceState* state) {
+    memcpy(state->state, state_, RANDOM_STATE_SIZE);
+    state->front = data_.fptr - (int32_t*) state_;
+    state->rear = data_.rptr - (int32_t*) state_;
+}
+
+/*
+ * continues the sequence of the RandomSource the state was taken from,
+ * returns false (and keeps the current state) if the state is invalid
+ */
+bool RandomSource::SetState(const RandomSourceState* state) {
+    int32_t* table = (int32_t*) state_;
+    int32_t size = RANDOM_STATE_SIZE / sizeof(int32_t);
+    if (state->front < 1 || state->front >= size || state->rear < 1 ||
+            state->rear >= size)
+        return false;
+
+    Seed(1); // sets the generator type, the table is replaced below
+    memcpy(state_, state->state, RANDOM_STATE_SIZE);
+    data_.fptr = table + state->front;
+    data_.rptr = table + state->rear;
+    return true;
+}
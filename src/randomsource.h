@@ -0,0 +1,48 @@
+//============================================================================
+// Name        : RandomSource.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : random number generator owned by a single clusterer, yields
+//               the same sequence as srand()/rand() but keeps its own state
+//               so that several clusterers can run in parallel
+//============================================================================
+
+
+#ifndef RANDOMSOURCE_H_
+#define RANDOMSOURCE_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define RANDOM_STATE_SIZE 128
+
+/*
+ * everything needed to continue the sequence of a RandomSource, e.g. after
+ * reading a checkpoint
+ */
+struct RandomSourceState {
+    char state[RANDOM_STATE_SIZE];
+    int32_t front;   // positions of the front and rear pointer in state
+    int32_t rear;
+};
+
+class RandomSource {
+public:
+    RandomSource(unsigned int seed = 1);
+
+    void Seed(unsigned int seed);
+    int Next();
+
+    void GetState(RandomSourceState* state);
+    bool SetState(const RandomSourceState* state);
+
+private:
+    char state_[RANDOM_STATE_SIZE];
+    struct random_data data_;
+
+    RandomSource(const RandomSource&);
+    RandomSource& operator=(const RandomSource&);
+};
+
+#endif /* RANDOMSOURCE_H_ */
@@ -0,0 +1,83 @@
+//============================================================================
+// Name        : RowNodePool.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : pool for the nodes of the hash tables of the cluster matrix,
+//               so that the joins reuse freed entries instead of calling
+//               the heap allocator for every insert and erase
+//============================================================================
+
+
+#include "rownodepool.h"
+
+#include <string.h>
+
+__thread int RowNodePool::thread_slot_ = 0;
+
+RowNodePool::RowNodePool() {
+    SetSlots(1);
+}
+
+RowNodePool::~RowNodePool() {
+    Release();
+    for (size_t i = 0; i < slots_.size(); i++)
+        delete slots_[i];
+}
+
+/*
+ * frees all chunks, no block of the pool may be in use any more
+ */
+void RowNodePool::Release() {
+    for (size_t i = 0; i < slots_.size(); i++) {
+        Slot* slot = slots_[i];
+        for (size_t j = 0; j < slot->chunks.size(); j++)
+            delete [] slot->chunks[j];
+        std::vector<char*>().swap(slot->chunks);
+        memset(slot->free_lists, 0, sizeof(slot->free_lists));
+        slot->chunk_pos = NULL;
+        slot->chunk_end = NULL;
+    }
+}
+
+/*
+ * provides slots for the given number of threads. Slots are never removed,
+ * the blocks of their free lists may still be in use by the tables.
+ */
+void RowNodePool::SetSlots(int slots) {
+    while ((int) slots_.size() < slots) {
+        Slot* slot = new Slot();
+        memset(slot->free_lists, 0, sizeof(slot->free_lists));
+        slot->chunk_pos = NULL;
+        slot->chunk_end = NULL;
+        slots_.push_back(slot);
+    }
+}
+
+/*
+ * slot used by the calling thread for all pools
+ */
+void RowNodePool::SetThreadSlot(int slot) {
+    thread_slot_ = slot;
+}
+
+void* RowNodePool::AllocateFromChunk(Slot* slot, size_t size) {
+    if (slot->chunk_pos == NULL || slot->chunk_pos + size > slot->chunk_end) {
+        slot->chunk_pos = new char[kChunkSize];
+        slot->chunk_end = slot->chunk_pos + kChunkSize;
+        slot->chunks.push_back(slot->chunk_pos);
+    }
+    void* block = slot->chunk_pos;
+    slot->chunk_pos += size;
+    return block;
+}
+
+/*
+ * bytes held by the chunks of all slots
+ */
+size_t RowNodePool::GetReservedBytes() {
+    size_t chunk_count = 0;
+    for (size_t i = 0; i < slots_.size(); i++)
+        chunk_count += slots_[i]->chunks.size();
+    return chunk_count * kChunkSize;
+}
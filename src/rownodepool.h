@@ -0,0 +1,148 @@
+//============================================================================
+// Name        : RowNodePool.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : pool for the nodes of the hash tables of the cluster matrix,
+//               so that the joins reuse freed entries instead of calling
+//               the heap allocator for every insert and erase
+//============================================================================
+
+
+#ifndef ROWNODEPOOL_H_
+#define ROWNODEPOOL_H_
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+/*
+ * Free lists of small blocks (one per multiple of 8 bytes up to
+ * kMaxBlockSize) carved from large chunks. The chunks are only released
+ * with the pool or by Release.
+ *
+ * Every thread that may allocate at the same time as others uses a slot of
+ * its own (SetThreadSlot), a block freed by a thread goes to the free list
+ * of its slot. Threads that never set a slot use slot 0.
+ */
+class RowNodePool {
+public:
+    static const size_t kMaxBlockSize = 64;
+
+    RowNodePool();
+    virtual ~RowNodePool();
+
+    void SetSlots(int slots);
+    static void SetThreadSlot(int slot);
+
+    void* Allocate(size_t size) {
+        Slot* slot = slots_[thread_slot_];
+        size_t size_class = (size - 1) / kGranularity;
+        void* block = slot->free_lists[size_class];
+        if (block == NULL)
+            return AllocateFromChunk(slot, (size_class + 1) * kGranularity);
+        slot->free_lists[size_class] = *(void**) block;
+        return block;
+    }
+
+    void Deallocate(void* block, size_t size) {
+        Slot* slot = slots_[thread_slot_];
+        size_t size_class = (size - 1) / kGranularity;
+        *(void**) block = slot->free_lists[size_class];
+        slot->free_lists[size_class] = block;
+    }
+
+    size_t GetReservedBytes();
+    void Release();
+
+private:
+    static const size_t kGranularity = 8;
+    static const size_t kSizeClasses = kMaxBlockSize / kGranularity;
+    static const size_t kChunkSize = 1 << 20;
+
+    struct Slot {
+        void* free_lists[kSizeClasses];
+        char* chunk_pos;
+        char* chunk_end;
+        std::vector<char*> chunks;
+    };
+
+    std::vector<Slot*> slots_;
+    static __thread int thread_slot_;
+
+    void* AllocateFromChunk(Slot* slot, size_t size);
+
+    RowNodePool(const RowNodePool&);
+    RowNodePool& operator=(const RowNodePool&);
+};
+
+/*
+ * allocator handing single small objects (the nodes) to a RowNodePool and
+ * everything else (the bucket arrays) to the heap. Without a pool it only
+ * uses the heap.
+ */
+template <class T>
+class RowNodeAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <class U>
+    struct rebind {
+        typedef RowNodeAllocator<U> other;
+    };
+
+    RowNodeAllocator() : pool_(NULL) {}
+    explicit RowNodeAllocator(RowNodePool* pool) : pool_(pool) {}
+    template <class U>
+    RowNodeAllocator(const RowNodeAllocator<U>& other) : pool_(other.get_pool()) {}
+
+    T* allocate(size_t n) {
+        if (n == 1 && sizeof(T) <= RowNodePool::kMaxBlockSize && pool_ != NULL)
+            return (T*) pool_->Allocate(sizeof(T));
+        return (T*) ::operator new(n * sizeof(T));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (n == 1 && sizeof(T) <= RowNodePool::kMaxBlockSize && pool_ != NULL)
+            pool_->Deallocate(p, sizeof(T));
+        else
+            ::operator delete(p);
+    }
+
+    void construct(T* p, const T& value) {
+        new ((void*) p) T(value);
+    }
+
+    void destroy(T* p) {
+        p->~T();
+    }
+
+    size_t max_size() const {
+        return (size_t) -1 / sizeof(T);
+    }
+
+    RowNodePool* get_pool() const {
+        return pool_;
+    }
+
+private:
+    RowNodePool* pool_;
+};
+
+template <class T, class U>
+inline bool operator==(const RowNodeAllocator<T>& a, const RowNodeAllocator<U>& b) {
+    return a.get_pool() == b.get_pool();
+}
+
+template <class T, class U>
+inline bool operator!=(const RowNodeAllocator<T>& a, const RowNodeAllocator<U>& b) {
+    return a.get_pool() != b.get_pool();
+}
+
+#endif /* ROWNODEPOOL_H_ */
@@ -0,0 +1,89 @@
+//============================================================================
+// Name        : ScanThreadPool.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : threads that are kept alive between the join steps to scan
+//               blocks of rows of the cluster matrix in parallel
+//============================================================================
+
+
+#include "scanthreadpool.h"
+
+#include <boost/bind.hpp>
+
+ScanThreadPool::ScanThreadPool() {
+    worker_count_ = 0;
+    task_ = NULL;
+    task_threads_ = 0;
+    generation_ = 0;
+    pending_ = 0;
+    stop_ = false;
+}
+
+ScanThreadPool::~ScanThreadPool() {
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        stop_ = true;
+    }
+    task_started_.notify_all();
+    workers_.join_all();
+}
+
+void ScanThreadPool::Run(ScanTask* task, int threads) {
+    if (threads <= 1) {
+        task->Run(0, 1);
+        return;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        // pool thread i runs part i
+        while (worker_count_ < threads - 1) {
+            worker_count_++;
+            workers_.create_thread(boost::bind(&ScanThreadPool::Work, this,
+                    worker_count_));
+        }
+        task_ = task;
+        task_threads_ = threads;
+        pending_ = threads - 1;
+        generation_++;
+    }
+    task_started_.notify_all();
+
+    task->Run(0, threads);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    while (pending_ > 0)
+        task_done_.wait(lock);
+    task_ = NULL;
+}
+
+void ScanThreadPool::Work(int thread) {
+    unsigned long done_generation = 0;
+    {
+        // a thread started for a task takes part in it
+        boost::mutex::scoped_lock lock(mutex_);
+        done_generation = generation_ - 1;
+    }
+
+    while (true) {
+        ScanTask* task;
+        int threads;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            while (!stop_ && generation_ == done_generation)
+                task_started_.wait(lock);
+            if (stop_) return;
+            done_generation = generation_;
+            task = task_;
+            threads = task_threads_;
+        }
+
+        if (thread < threads) {
+            task->Run(thread, threads);
+            boost::mutex::scoped_lock lock(mutex_);
+            if (--pending_ == 0) task_done_.notify_one();
+        }
+    }
+}
@@ -0,0 +1,58 @@
+//============================================================================
+// Name        : ScanThreadPool.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : threads that are kept alive between the join steps to scan
+//               blocks of rows of the cluster matrix in parallel
+//============================================================================
+
+
+#ifndef SCANTHREADPOOL_H_
+#define SCANTHREADPOOL_H_
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/*
+ * work split into threads parts, Run is called once for every part
+ */
+class ScanTask {
+public:
+    virtual ~ScanTask() {}
+    virtual void Run(int thread, int threads) = 0;
+};
+
+/*
+ * Runs the parts 1..threads-1 of a task on the pool threads and part 0 on the
+ * calling thread, then waits for all parts. The threads are started when
+ * they are needed first and wait for the next task in between, so a task
+ * costs two wakeups instead of starting threads.
+ */
+class ScanThreadPool {
+public:
+    ScanThreadPool();
+    virtual ~ScanThreadPool();
+
+    void Run(ScanTask* task, int threads);
+
+private:
+    boost::thread_group workers_;
+    int worker_count_;
+    boost::mutex mutex_;
+    boost::condition_variable task_started_;
+    boost::condition_variable task_done_;
+    ScanTask* task_;
+    int task_threads_;
+    unsigned long generation_;  // number of tasks started
+    int pending_;               // parts of the task still running
+    bool stop_;
+
+    void Work(int thread);
+
+    ScanThreadPool(const ScanThreadPool&);
+    ScanThreadPool& operator=(const ScanThreadPool&);
+};
+
+#endif /* SCANTHREADPOOL_H_ */
@@ -11,45 +11,156 @@
 
 #include "sparseclusteringmatrix.h"
 
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
 #include "graph.h"
 #include "partition.h"
 
+// below this number of adjacency entries the matrix is filled by one thread
+static const t_edge_count kMinParallelEntries = 1 << 16;
+
+SparseClusteringMatrix::SparseClusteringMatrix() {
+    rows_ = NULL;
+    row_sums_ = NULL;
+    dimension_ = 0;
+    row_count_ = 0;
+    capacity_ = 0;
+    threads_ = 1;
+}
+
 SparseClusteringMatrix::SparseClusteringMatrix(Graph* graph) {
     rows_ = NULL;
     row_sums_ = NULL;
+    row_count_ = 0;
+    capacity_ = 0;
+    threads_ = 1;
 
     init(graph);
 }
 
 SparseClusteringMatrix::SparseClusteringMatrix(Graph* graph, Partition* clusters) {
-    dimension_ = clusters->get_partition_vector()->size();
+    rows_ = NULL;
+    row_sums_ = NULL;
+    row_count_ = 0;
+    capacity_ = 0;
+    threads_ = 1;
 
-    int* clustermap = new int[graph->get_vertex_count()]; // maps vertex_id -> cluster_id
-    for (int i = 0; i < dimension_; i++) {
-        t_id_list* cluster = clusters->get_partition_vector()->at(i);
-        int cluster_row = *(cluster->begin()); // cluster will be stored in row of first vertex
+    Reset(graph, clusters);
+}
 
-        for (t_id_list::iterator iter = cluster->begin(); iter != cluster->end(); ++iter) {
-            int vertexid = *iter;
-            clustermap[vertexid] = cluster_row;
+/*
+ * Provides row_count empty rows. Rows allocated by an earlier use are
+ * cleared and get the bucket count of a new row, so the order of the
+ * entries (and the ties of the joins) does not depend on earlier runs; only
+ * the rows and their nodes are reused.
+ */
+void SparseClusteringMatrix::Allocate(t_vertex_id row_count) {
+    if (row_count > capacity_) {
+        ReleaseRows();
+        // the rows are constructed in place to pass them the node pool
+        rows_ = (t_row_value_map*) ::operator new(row_count * sizeof(t_row_value_map));
+        RowNodeAllocator<t_row_value_map_entry> allocator(&node_pool_);
+        for (t_vertex_id i = 0; i < row_count; i++)
+            new (&rows_[i]) t_row_value_map(allocator);
+        row_sums_ = new double[row_count];
+        capacity_ = row_count;
+    } else {
+        for (t_vertex_id i = 0; i < row_count_; i++) {
+            rows_[i].clear();
+            rows_[i].rehash(0);
         }
     }
+    row_count_ = row_count;
+}
 
-    rows_ = new t_row_value_map[graph->get_vertex_count()];
-    row_sums_ = new double[graph->get_vertex_count()];
+void SparseClusteringMatrix::ReleaseRows() {
+    if (rows_ != NULL) {
+        for (t_vertex_id i = 0; i < capacity_; i++)
+            rows_[i].~t_row_value_map();
+        ::operator delete(rows_);
+        rows_ = NULL;
+    }
+    if (row_sums_ != NULL) delete [] row_sums_;
+    row_sums_ = NULL;
+    capacity_ = 0;
+}
 
+void SparseClusteringMatrix::Reset(Graph* graph) {
+    init(graph);
+}
+
+void SparseClusteringMatrix::SetThreads(int threads) {
+    threads_ = threads < 1 ? 1 : threads;
+    node_pool_.SetSlots(threads_);
+}
+
+int SparseClusteringMatrix::GetBuildThreads(Graph* graph) {
+    if (2 * graph->get_edge_count() < kMinParallelEntries) return 1;
+    if (threads_ > graph->get_vertex_count()) return 1;
+    return threads_;
+}
+
+/*
+ * fills the matrix with the fractions of edges between the clusters of the
+ * partition, the cluster is stored in the row of its first vertex.
+ *
+ * With several threads the edges are mapped to cluster pairs per range of
+ * vertices and handed to the thread owning the row (row % threads), which
+ * aggregates them. Every owner reads the pairs in the order of the vertices,
+ * so the rows are filled in the same order as by one thread and the matrix
+ * is identical.
+ */
+void SparseClusteringMatrix::Reset(Graph* graph, Partition* clusters) {
+    dimension_ = clusters->get_partition_vector()->size();
+    clustermap_.resize(graph->get_vertex_count()); // maps vertex_id -> cluster_id
+
+    Allocate(graph->get_vertex_count());
+
+    int threads = GetBuildThreads(graph);
+    if (threads > 1) {
+        std::vector<std::vector<std::vector<t_vertex_pair> > > pairs(threads,
+                std::vector<std::vector<t_vertex_pair> >(threads));
+
+        boost::thread_group map_clusters;
+        for (int t = 0; t < threads; t++)
+            map_clusters.create_thread(boost::bind(
+                    &SparseClusteringMatrix::MapClusters, this, clusters, t,
+                    threads));
+        map_clusters.join_all();
+
+        boost::thread_group map_edges;
+        for (int t = 0; t < threads; t++)
+            map_edges.create_thread(boost::bind(
+                    &SparseClusteringMatrix::MapEdges, this, graph, t, threads,
+                    &pairs[t]));
+        map_edges.join_all();
+
+        boost::thread_group reduce_rows;
+        for (int t = 0; t < threads; t++)
+            reduce_rows.create_thread(boost::bind(
+                    &SparseClusteringMatrix::ReduceRows, this, graph, t,
+                    threads, &pairs));
+        reduce_rows.join_all();
+        return;
+    }
+
+    MapClusters(clusters, 0, 1);
+
+    t_vertex_id* clustermap = &clustermap_[0];
     double initvalue = 1.0 / (2 * graph->get_edge_count()); // initial value
                                                           // 1 / (2*|E|)
 
 
     // for every neighbor fill field in sparse matrix (== insert hash table )
-    for (int i = 0; i < graph->get_vertex_count(); i++) {
-        int cluster1 = clustermap[i];
+    vector<t_vertex_id> buffer;
+    for (t_vertex_id i = 0; i < graph->get_vertex_count(); i++) {
+        t_vertex_id cluster1 = clustermap[i];
 
-        vector<int>* neighbors = graph->GetNeighbors(i);
-        int neighborCount = neighbors->size();
-        for (int j = 0; j < neighborCount; j++) {
-            int cluster2 = clustermap[neighbors->at(j)];
+        vector<t_vertex_id>* neighbors = graph->GetNeighbors(i, &buffer);
+        size_t neighborCount = neighbors->size();
+        for (size_t j = 0; j < neighborCount; j++) {
+            t_vertex_id cluster2 = clustermap[neighbors->at(j)];
 
             if (rows_[cluster1].find(cluster2) != rows_[cluster1].end())
                 rows_[cluster1][cluster2] += initvalue;
@@ -58,61 +169,187 @@ SparseClusteringMatrix::SparseClusteringMatrix(Graph* graph, Partition* clusters
         }
     }
 
-    for (int i = 0; i < graph->get_vertex_count(); i++) {
+    for (t_vertex_id i = 0; i < graph->get_vertex_count(); i++) {
         double sum = 0.0;
-        if (rows_[i].size() > 0) {
-            for (t_row_value_map::iterator j = rows_[i].begin(); j != rows_[i].end(); ++j) {
-                sum += rows_[i][j->first];
-            }
-        }
+        for (t_row_value_map::iterator j = rows_[i].begin(); j != rows_[i].end(); ++j)
+            sum += j->second;
         row_sums_[i] = sum;
     }
+}
+
+/*
+ * sets clustermap_ for the clusters thread, thread + threads, ...
+ */
+void SparseClusteringMatrix::MapClusters(Partition* clusters, int thread,
+        int threads) {
+    for (t_vertex_id i = thread; i < dimension_; i += threads) {
+        t_id_list* cluster = clusters->get_partition_vector()->at(i);
+        t_vertex_id cluster_row = *(cluster->begin()); // cluster will be stored in row of first vertex
+
+        for (t_id_list::iterator iter = cluster->begin(); iter != cluster->end(); ++iter)
+            clustermap_[*iter] = cluster_row;
+    }
+}
+
+/*
+ * maps the edges of the thread-th range of vertices to pairs of cluster rows,
+ * sorted by the thread owning the first row
+ */
+void SparseClusteringMatrix::MapEdges(Graph* graph, int thread, int threads,
+        std::vector<std::vector<t_vertex_pair> >* owner_pairs) {
+    t_vertex_id vertex_count = graph->get_vertex_count();
+    t_vertex_id first = (t_vertex_id) ((t_edge_count) vertex_count * thread / threads);
+    t_vertex_id last = (t_vertex_id) ((t_edge_count) vertex_count * (thread + 1) / threads);
+
+    vector<t_vertex_id> buffer;
+    for (t_vertex_id i = first; i < last; i++) {
+        t_vertex_id cluster1 = clustermap_[i];
+        std::vector<t_vertex_pair>& target = (*owner_pairs)[cluster1 % threads];
+
+        vector<t_vertex_id>* neighbors = graph->GetNeighbors(i, &buffer);
+        for (size_t j = 0; j < neighbors->size(); j++)
+            target.push_back(std::make_pair(cluster1, clustermap_[(*neighbors)[j]]));
+    }
+}
+
+/*
+ * aggregates the pairs of all vertex ranges into the rows owned by thread and
+ * computes their row sums
+ */
+void SparseClusteringMatrix::ReduceRows(Graph* graph, int thread, int threads,
+        std::vector<std::vector<std::vector<t_vertex_pair> > >* pairs) {
+    RowNodePool::SetThreadSlot(thread);
+    double initvalue = 1.0 / (2 * graph->get_edge_count());
+
+    for (int range = 0; range < threads; range++) {
+        std::vector<t_vertex_pair>& range_pairs = (*pairs)[range][thread];
+        for (size_t i = 0; i < range_pairs.size(); i++) {
+            t_row_value_map& row = rows_[range_pairs[i].first];
+            t_row_value_map::iterator entry = row.find(range_pairs[i].second);
+            if (entry != row.end())
+                entry->second += initvalue;
+            else
+                row[range_pairs[i].second] = initvalue;
+        }
+        std::vector<t_vertex_pair>().swap(range_pairs); // release early
+    }
 
-    delete [] clustermap;
+    for (t_vertex_id i = thread; i < graph->get_vertex_count(); i += threads) {
+        double sum = 0.0;
+        for (t_row_value_map::iterator j = rows_[i].begin(); j != rows_[i].end(); ++j)
+            sum += j->second;
+        row_sums_[i] = sum;
+    }
 }
 
 SparseClusteringMatrix::~SparseClusteringMatrix() {
-    if (rows_ != NULL) delete [] rows_;
-    if (row_sums_ != NULL) delete [] row_sums_;
+    ReleaseRows();
 }
 
 void SparseClusteringMatrix::init(Graph* graph) {
     dimension_ = graph->get_vertex_count();
 
-    rows_ = new t_row_value_map[dimension_];
-    row_sums_ = new double[dimension_];
+    Allocate(dimension_);
+
+    // every row only depends on the neighbors of its vertex, so the rows are
+    // split into one range per thread
+    int threads = GetBuildThreads(graph);
+    if (threads > 1) {
+        boost::thread_group fill_rows;
+        for (int t = 0; t < threads; t++) {
+            t_vertex_id first = (t_vertex_id) ((t_edge_count) dimension_ * t / threads);
+            t_vertex_id last = (t_vertex_id) ((t_edge_count) dimension_ * (t + 1) / threads);
+            fill_rows.create_thread(boost::bind(
+                    &SparseClusteringMatrix::FillRows, this, graph, t, first,
+                    last));
+        }
+        fill_rows.join_all();
+    } else {
+        FillRows(graph, 0, 0, dimension_);
+    }
+}
+
+void SparseClusteringMatrix::FillRows(Graph* graph, int thread,
+        t_vertex_id first, t_vertex_id last) {
+    RowNodePool::SetThreadSlot(thread);
 
     double initvalue = 1.0 / (2 * graph->get_edge_count()); // initial value
                                                           // 1 / (2*|E|)
 
     // for every neighbor fill field in sparse matrix (== insert hash table )
-    for (int i = 0; i < dimension_; i++) {
-        vector<int>* neighbors = graph->GetNeighbors(i);
-        int neighbor_count = neighbors->size();
+    vector<t_vertex_id> buffer;
+    for (t_vertex_id i = first; i < last; i++) {
+        vector<t_vertex_id>* neighbors = graph->GetNeighbors(i, &buffer);
+        size_t neighbor_count = neighbors->size();
         rows_[i].rehash(neighbor_count * 1.1);
 
-        for (int j = 0; j < neighbor_count; j++)
+        for (size_t j = 0; j < neighbor_count; j++)
             rows_[i][neighbors->at(j)] = initvalue;
-    }
 
-    for (int i = 0; i < dimension_; i++) {
         row_sums_[i] = initvalue * rows_[i].size();
     }
 }
 
-t_row_value_map* SparseClusteringMatrix::GetRow(int &rowIndex) {
+t_row_value_map* SparseClusteringMatrix::GetRow(t_vertex_id &rowIndex) {
     return &rows_[rowIndex];
 }
 
-double& SparseClusteringMatrix::GetRowSum(int &rowIndex) {
+double& SparseClusteringMatrix::GetRowSum(t_vertex_id &rowIndex) {
     return row_sums_[rowIndex];
 }
 
-int SparseClusteringMatrix::GetRowEntries(int &rowIndex) {
+const double* SparseClusteringMatrix::GetRowSums() {
+    return row_sums_;
+}
+
+t_vertex_id SparseClusteringMatrix::GetRowEntries(t_vertex_id &rowIndex) {
     return rows_[rowIndex].size();
 }
 
-double& SparseClusteringMatrix::Get(int &rowIndex, int &columnIndex) {
+/*
+ * bytes reserved by the node pool of the rows
+ */
+size_t SparseClusteringMatrix::GetPoolBytes() {
+    return node_pool_.GetReservedBytes();
+}
+
+/*
+ * bytes held by the matrix, the rows keep their buckets when they are
+ * cleared
+ */
+size_t SparseClusteringMatrix::GetMemoryBytes() {
+    size_t bytes = capacity_ * (sizeof(t_row_value_map) + sizeof(double)) +
+            clustermap_.capacity() * sizeof(t_vertex_id) +
+            node_pool_.GetReservedBytes();
+    for (t_vertex_id i = 0; i < capacity_; i++)
+        bytes += (rows_[i].bucket_count() + 1) * sizeof(void*);
+    return bytes;
+}
+
+/*
+ * frees all rows and the node pool, the next Reset allocates them again
+ */
+void SparseClusteringMatrix::Release() {
+    ReleaseRows();
+    node_pool_.Release();
+    std::vector<t_vertex_id>().swap(clustermap_);
+    row_count_ = 0;
+    dimension_ = 0;
+}
+
+/*
+ * bytes of the matrix of a graph at the end of the joins: a row per vertex
+ * and about 100 bytes per adjacency entry (pool block, buckets of the grown
+ * rows, which keep them when they are joined, and free blocks)
+ */
+size_t SparseClusteringMatrix::EstimateBytes(t_vertex_id vertex_count,
+        t_edge_count edge_count) {
+    return (size_t) vertex_count * (sizeof(t_row_value_map) + sizeof(double) +
+            sizeof(t_vertex_id) + 2 * sizeof(void*)) +
+            (size_t) edge_count * 2 * 100;
+}
+
+double& SparseClusteringMatrix::Get(t_vertex_id &rowIndex, t_vertex_id &columnIndex) {
     t_row_value_map::iterator iter = rows_[rowIndex].find(columnIndex);
     return iter->second;
 }
@@ -121,10 +358,10 @@ double& SparseClusteringMatrix::Get(int &rowIndex, int &columnIndex) {
  *  Joins two clusters by adding row b to row a. For better performance, row b should have
  *  less entries than row a.
  */
-void SparseClusteringMatrix::JoinCluster(int &a, int &b) {
+void SparseClusteringMatrix::JoinCluster(t_vertex_id &a, t_vertex_id &b) {
     // Adjust matrix E
     for (t_row_value_map::iterator iter = rows_[b].begin(); iter != rows_[b].end(); ++iter) {
-        int column = iter->first;
+        t_vertex_id column = iter->first;
         double value = iter->second;
 
         double new_value = value;
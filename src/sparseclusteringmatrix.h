@@ -18,8 +18,14 @@
 
 #include <boost/unordered_map.hpp>
 
-typedef boost::unordered_map<int, double> t_row_value_map;
-typedef boost::unordered_map<int, double>::value_type t_row_value_map_entry;
+#include "indextypes.h"
+#include "rownodepool.h"
+
+// the rows allocate their entries from the node pool of their matrix
+typedef boost::unordered_map<t_vertex_id, double, boost::hash<t_vertex_id>,
+        std::equal_to<t_vertex_id>,
+        RowNodeAllocator<std::pair<const t_vertex_id, double> > > t_row_value_map;
+typedef t_row_value_map::value_type t_row_value_map_entry;
 
 
 class Graph;
@@ -27,22 +33,48 @@ class Partition;
 
 class SparseClusteringMatrix {
 public:
+	SparseClusteringMatrix();
 	SparseClusteringMatrix(Graph* graph);
 	SparseClusteringMatrix(Graph* graph, Partition* clusters);
 	virtual ~SparseClusteringMatrix();
 
-	void JoinCluster(int &a, int &b);
-	double& Get(int &rowIndex, int &columnIndex);
-	t_row_value_map* GetRow(int &rowIndex);
-	double& GetRowSum(int &rowIndex);
-	int GetRowEntries(int &rowIndex);
+	void Reset(Graph* graph);
+	void Reset(Graph* graph, Partition* clusters);
+	void SetThreads(int threads);
+
+	void JoinCluster(t_vertex_id &a, t_vertex_id &b);
+	double& Get(t_vertex_id &rowIndex, t_vertex_id &columnIndex);
+	t_row_value_map* GetRow(t_vertex_id &rowIndex);
+	double& GetRowSum(t_vertex_id &rowIndex);
+	const double* GetRowSums();
+	t_vertex_id GetRowEntries(t_vertex_id &rowIndex);
+	size_t GetPoolBytes();
+	size_t GetMemoryBytes();
+	void Release();
+
+	static size_t EstimateBytes(t_vertex_id vertex_count, t_edge_count edge_count);
 
 private:
 	t_row_value_map* rows_; // matrix E
 	double* row_sums_;   // vector A
-	int dimension_;	   // number of rows/columns of E
+	t_vertex_id dimension_;	   // number of rows/columns of E
+	t_vertex_id row_count_;    // number of rows in use
+	t_vertex_id capacity_;     // number of allocated rows
+	std::vector<t_vertex_id> clustermap_; // maps vertex_id -> cluster row
+	int threads_;              // threads used to fill the matrix
+	RowNodePool node_pool_;    // entries of the rows, released with the matrix
 
 	void init(Graph* graph);
+	void Allocate(t_vertex_id row_count);
+	void ReleaseRows();
+	int GetBuildThreads(Graph* graph);
+	void FillRows(Graph* graph, int thread, t_vertex_id first,
+		t_vertex_id last);
+	void MapClusters(Partition* clusters, int thread, int threads);
+	void MapEdges(Graph* graph, int thread, int threads,
+		std::vector<std::vector<t_vertex_pair> >* owner_pairs);
+	void ReduceRows(Graph* graph, int thread, int threads,
+		std::vector<std::vector<std::vector<t_vertex_pair> > >* pairs);
 };
 
 #endif /* SPARSECLUSTERINGMATRIX_H_ */
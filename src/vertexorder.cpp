@@ -0,0 +1,126 @@
+//============================================================================
+// Name        : VertexOrder.cpp
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : orders of the vertices of a graph that place adjacent
+//               vertices close to each other, used to relabel graphs after
+//               loading for better memory locality
+//============================================================================
+
+
+#include "vertexorder.h"
+
+#include <algorithm>
+
+#include "graph.h"
+
+/*
+ * sorts vertex ids by degree, descending or ascending, ties by id
+ */
+class DegreeCompare {
+public:
+    DegreeCompare(Graph* graph, bool descending) :
+            graph_(graph), descending_(descending) {
+    }
+
+    bool operator()(t_vertex_id a, t_vertex_id b) const {
+        size_t degree_a = graph_->GetDegree(a);
+        size_t degree_b = graph_->GetDegree(b);
+        if (degree_a != degree_b)
+            return descending_ ? degree_a > degree_b : degree_a < degree_b;
+        return a < b;
+    }
+
+private:
+    Graph* graph_;
+    bool descending_;
+};
+
+bool IsValidVertexOrder(std::string method) {
+    return method == "none" || method == "degree" || method == "bfs" ||
+            method == "rcm";
+}
+
+/*
+ * Breadth first search over all components. Components are started from
+ * the vertices in the order of starts, with sort_neighbors the neighbors of
+ * a vertex are visited by ascending degree (Cuthill-McKee).
+ */
+static void AppendBreadthFirst(Graph* graph, std::vector<t_vertex_id>* starts,
+        bool sort_neighbors, std::vector<t_vertex_id>* order) {
+    std::vector<bool> visited(graph->get_vertex_count(), false);
+    std::vector<t_vertex_id> neighbors;
+    std::vector<t_vertex_id> buffer;
+    DegreeCompare ascending(graph, false);
+
+    for (size_t s = 0; s < starts->size(); s++) {
+        t_vertex_id start = (*starts)[s];
+        if (visited[start]) continue;
+
+        // order doubles as the queue of the search
+        size_t head = order->size();
+        order->push_back(start);
+        visited[start] = true;
+        while (head < order->size()) {
+            t_vertex_id vertex_id = (*order)[head++];
+            vector<t_vertex_id>* adjacent = graph->GetNeighbors(vertex_id,
+                    &buffer);
+            neighbors.assign(adjacent->begin(), adjacent->end());
+            if (sort_neighbors)
+                std::sort(neighbors.begin(), neighbors.end(), ascending);
+
+            for (size_t j = 0; j < neighbors.size(); j++) {
+                if (visited[neighbors[j]]) continue;
+                visited[neighbors[j]] = true;
+                order->push_back(neighbors[j]);
+            }
+        }
+    }
+}
+
+/*
+ * returns the vertices in the new order (entry i becomes vertex i):
+ *   degree  descending degree, hubs and their rows first
+ *   bfs     breadth first search, components started at the vertex of
+ *           highest degree
+ *   rcm     reverse Cuthill-McKee, components started at a vertex of lowest
+ *           degree
+ *   none    order of the file
+ */
+std::vector<t_vertex_id>* GetVertexOrder(Graph* graph, std::string method) {
+    t_vertex_id vertex_count = graph->get_vertex_count();
+    std::vector<t_vertex_id>* order = new std::vector<t_vertex_id>();
+    order->reserve(vertex_count);
+
+    std::vector<t_vertex_id> vertices(vertex_count);
+    for (t_vertex_id i = 0; i < vertex_count; i++)
+        vertices[i] = i;
+
+    if (method == "degree") {
+        std::sort(vertices.begin(), vertices.end(), DegreeCompare(graph, true));
+        order->swap(vertices);
+    } else if (method == "bfs") {
+        std::sort(vertices.begin(), vertices.end(), DegreeCompare(graph, true));
+        AppendBreadthFirst(graph, &vertices, false, order);
+    } else if (method == "rcm") {
+        std::sort(vertices.begin(), vertices.end(), DegreeCompare(graph, false));
+        AppendBreadthFirst(graph, &vertices, true, order);
+        std::reverse(order->begin(), order->end());
+    } else {
+        order->swap(vertices);
+    }
+    return order;
+}
+
+/*
+ * relabels the graph in the order given by method
+ */
+void ReorderGraph(Graph* graph, std::string method) {
+    if (method == "none")
+        return;
+
+    std::vector<t_vertex_id>* order = GetVertexOrder(graph, method);
+    graph->Relabel(order);
+    delete order;
+}
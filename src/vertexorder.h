@@ -0,0 +1,26 @@
+//============================================================================
+// Name        : VertexOrder.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : orders of the vertices of a graph that place adjacent
+//               vertices close to each other, used to relabel graphs after
+//               loading for better memory locality
+//============================================================================
+
+
+#ifndef VERTEXORDER_H_
+#define VERTEXORDER_H_
+
+#include <string>
+#include <vector>
+
+#include "indextypes.h"
+
+class Graph;
+
+bool IsValidVertexOrder(std::string method);
+std::vector<t_vertex_id>* GetVertexOrder(Graph* graph, std::string method);
+void ReorderGraph(Graph* graph, std::string method);
+
+#endif /* VERTEXORDER_H_ */
@@ -0,0 +1,25 @@
+//============================================================================
+// Name        : WallTime.h
+// Author      :
+// Version     :
+// Copyright   : Karlsruhe Institute of Technology
+// Description : wall clock time for timing runs in multithreaded programs,
+//               where clock() would add up the time of all threads
+//============================================================================
+
+
+#ifndef WALLTIME_H_
+#define WALLTIME_H_
+
+#include <sys/time.h>
+
+/*
+ * returns the current wall clock time in seconds
+ */
+inline double GetWallTime() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+#endif /* WALLTIME_H_ */